@@ -27,6 +27,10 @@
 #elif defined(linux)
 #include <unistd.h>
 #endif
+#if defined(unix) || defined(__unix__)
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 /* -- global variables -- */
 
@@ -44,8 +48,15 @@ int annotate;			/* output source references */
 int pagenumbers;		/* write page numbers */
 int epsf;			/* 1: EPSF, 2: SVG, 3: embedded ABC */
 int svg;			/* 1: SVG, 2: XHTML */
+int shared_defs;		/* --shared-defs: one <defs> per document */
 int showerror;			/* show the errors */
 int pipeformat = 0;		/* format for bagpipes regardless of key */
+static int serve;		/* --serve: persistent conversion server */
+static int build_index;		/* --build-index: create the tune indexes */
+int njobs;			/* -J: number of parallel jobs */
+int ijob;			/* index of the current job */
+int profile;			/* --profile: time the generation phases */
+static char *prof_fn;		/* --profile=file */
 
 char outfn[FILENAME_MAX];	/* output file name */
 int file_initialized;		/* for output file */
@@ -81,6 +92,8 @@ static struct str_a {
 	char	str[2];		/* start of memory area */
 } *str_r[MAXAREAL], *str_c[MAXAREAL];	/* root and current area pointers */
 
+static long long arena_sz;		/* total of the arena allocations */
+
 /* -- local functions -- */
 static void read_def_format(void);
 
@@ -137,33 +150,168 @@ FILE *open_file(char *fn,	/* file name */
 	return open_ext(rfn, ext);
 }
 
+/* -- tune index -- */
+/* The index of an ABC file is in the file '<ABC file>.idx'.
+ * It starts by the line
+ *	%abcm2ps-index <mtime> <size> <charset hint offset>
+ * and it contains, for each tune, a line
+ *	<offset> <length> <number of lines> <gap length> <header length>
+ * followed by the text before the tune (since the previous one),
+ * the tune header (X: to K:) and a newline.
+ * A last entry with a null length contains the end of the file.
+ * A tune goes from X: up to the first empty line, as when it is
+ * skipped by the front-end. */
+
+/* -- load the ABC file with the selected tunes only -- */
+/* The not selected tunes are replaced by empty lines
+ * so that the line numbers are kept.
+ * return NULL if no index or if the whole file must be read. */
+static char *index_read(FILE *fin, char *fn)
+{
+	FILE *fidx;
+	struct stat sbuf;
+	char *buf, *file, *p, *q, *h, *end, fnidx[FILENAME_MAX];
+	char x0[] = "X:0\n";
+	long mt, size, hint, off, len, blen, l, nl, gl, hl;
+
+	if (strlen(fn) + 5 > sizeof fnidx)
+		return NULL;
+	sprintf(fnidx, "%s.idx", fn);
+	if ((fidx = fopen(fnidx, "rb")) == NULL)
+		return NULL;
+	fstat(fileno(fin), &sbuf);
+	if (fscanf(fidx, "%%abcm2ps-index %ld %ld %ld",
+			&mt, &size, &hint) != 3
+	 || mt != (long) sbuf.st_mtime
+	 || size != (long) sbuf.st_size
+	 || hint < -1 || hint >= size
+	 || tune_selected((unsigned char *) x0) < 0) {	/* no selection */
+		fclose(fidx);
+		return NULL;
+	}
+
+	/* load the index */
+	l = ftell(fidx);
+	fseek(fidx, 0L, SEEK_END);
+	blen = ftell(fidx) - l;
+	fseek(fidx, l, SEEK_SET);
+	buf = malloc(blen + 1);
+	if (!buf) {
+		fclose(fidx);
+		return NULL;
+	}
+	if (fread(buf, 1, blen, fidx) != blen) {
+		free(buf);
+		fclose(fidx);
+		return NULL;
+	}
+	fclose(fidx);
+	buf[blen] = '\0';
+
+	/* build the file from the global parts and the selected tunes */
+	/* (the index may be corrupted: check everything) */
+	file = malloc(size + 8);
+	if (!file) {
+		free(buf);
+		return NULL;
+	}
+	end = file + size + 7;		/* (room for a charset hint and EOS) */
+	q = file;
+	p = buf;
+	for (;;) {
+		off = strtol(p, &p, 10);
+		len = strtol(p, &p, 10);
+		nl = strtol(p, &p, 10);
+		gl = strtol(p, &p, 10);
+		hl = strtol(p, &p, 10);
+		if (*p++ != '\n'
+		 || off < 0 || len < 0 || nl < 0 || gl < 0 || hl < 0
+		 || off > size || len > size - off || nl > size
+		 || gl > buf + blen - p
+		 || hl >= buf + blen - p - gl
+		 || gl > end - q)
+			goto err;
+		memcpy(q, p, gl);		/* global part */
+		q += gl;
+		p += gl;
+		if (len == 0)			/* end of file */
+			break;
+		h = p;
+		p += hl;
+		*p++ = '\0';			/* (was '\n') */
+		if (tune_selected((unsigned char *) h)) {
+			if (len > end - q)
+				goto err;
+			fseek(fin, off, SEEK_SET);
+			if (fread(q, 1, len, fin) != len)
+				goto err;
+			q += len;
+			continue;
+		}
+		if (nl + 3 > end - q)		/* newlines, hint and '\n' */
+			goto err;
+		while (--nl > 0)
+			*q++ = '\n';
+
+		/* if the charset guess is in this tune,
+		 * put its characters in a comment */
+		if (hint >= off && hint < off + len) {
+			*q++ = '%';
+			fseek(fin, hint, SEEK_SET);
+			if (fread(q, 1, 2, fin) != 2)
+				goto err;
+			q++;
+			if (*q != '\n' && *q != '\r')
+				q++;
+		}
+		*q++ = '\n';
+	}
+	*q = '\0';
+	free(buf);
+
+	/* the selection must not change in the file */
+	if (strstr(file, "select") == NULL)
+		return file;
+	free(file);
+	return NULL;
+err:
+	free(file);
+	free(buf);
+	return NULL;
+}
+
 /* -- read a whole input file -- */
 /* return the real/full file name in tex_buf[] */
-static char *read_file(char *fn, char *ext)
+/* When possible, a regular file is mapped in memory (*msize is then
+ * the size of the mapping). The mapping is private and writable, so that
+ * the front end may put temporary EOS's in the lines.
+ * The file must be released by free_file(). */
+static char *read_file(char *fn, char *ext, size_t *msize)
 {
-	size_t fsize;
+	size_t fsize, bsize;
 	FILE *fin;
 	char *file;
 
+	*msize = 0;
 	if (*fn == '\0') {
 		strcpy(tex_buf, "stdin");
 		fsize = 0;
-		file = malloc(8192);
+		bsize = 8192;
+		file = malloc(bsize);
 		for (;;) {
 			int l;
 
-			l = fread(&file[fsize], 1, 8192, stdin);
+			l = fread(&file[fsize], 1, bsize - fsize, stdin);
 			fsize += l;
-			if (l != 8192)
+			if (fsize != bsize)
 				break;
-			file = realloc(file, fsize + 8192);
+			bsize *= 2;
+			file = realloc(file, bsize);
 		}
 		if (ferror(stdin) != 0) {
 			free(file);
 			return 0;
 		}
-		if (fsize % 8192 == 0)
-			file = realloc(file, fsize + 2);
 		time(&fmtime);
 	} else {
 		struct stat sbuf;
@@ -171,12 +319,39 @@ static char *read_file(char *fn, char *ext)
 		fin = open_file(fn, ext, tex_buf);
 		if (!fin)
 			return NULL;
+		if (*ext == 'a' && !build_index
+		 && (file = index_read(fin, tex_buf)) != NULL) {
+			fstat(fileno(fin), &sbuf);
+			memcpy(&fmtime, &sbuf.st_mtime, sizeof fmtime);
+			fclose(fin);
+			return file;
+		}
 		if (fseek(fin, 0L, SEEK_END) < 0) {
 			fclose(fin);
 			return NULL;
 		}
 		fsize = ftell(fin);
 		rewind(fin);
+		fstat(fileno(fin), &sbuf);
+		memcpy(&fmtime, &sbuf.st_mtime, sizeof fmtime);
+#ifdef HAVE_MMAP
+		/* the end of the last page is filled with zeros,
+		 * giving the EOS */
+		if (fsize != 0
+		 && fsize % sysconf(_SC_PAGESIZE) != 0) {
+			file = mmap(NULL, fsize, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE
+#ifdef MAP_POPULATE
+						| MAP_POPULATE
+#endif
+					, fileno(fin), 0);
+			if (file != MAP_FAILED) {
+				fclose(fin);
+				*msize = fsize;
+				return file;
+			}
+		}
+#endif
 		if ((file = malloc(fsize + 2)) == NULL) {
 			fclose(fin);
 			return NULL;
@@ -187,19 +362,321 @@ static char *read_file(char *fn, char *ext)
 			free(file);
 			return NULL;
 		}
-		fstat(fileno(fin), &sbuf);
-		memcpy(&fmtime, &sbuf.st_mtime, sizeof fmtime);
 		fclose(fin);
 	}
 	file[fsize] = '\0';
 	return file;
 }
 
+/* -- release a file loaded by read_file() -- */
+static void free_file(char *file, size_t msize)
+{
+#ifdef HAVE_MMAP
+	if (msize != 0) {
+		munmap(file, msize);
+		return;
+	}
+#endif
+	free(file);
+}
+
+/* -- create the index of an ABC file -- */
+static void index_build(char *fn)
+{
+	FILE *fidx;
+	struct stat sbuf;
+	char *file, *p, *s, *t, *g, *hint, fnidx[FILENAME_MAX];
+	size_t msize;
+	int l, nl, begin, ntunes;
+
+	if (*fn == '\0'
+	 || (file = read_file(fn, "abc", &msize)) == NULL) {
+		error(1, NULL, "Cannot index the file '%s'", fn);
+		return;
+	}
+	stat(tex_buf, &sbuf);
+	sprintf(fnidx, "%s.idx", tex_buf);
+	if ((fidx = fopen(fnidx, "wb")) == NULL) {
+		error(1, NULL, "Cannot create the index file %s", fnidx);
+		free_file(file, msize);
+		return;
+	}
+	hint = (char *) charset_hint((unsigned char *) file);
+	fprintf(fidx, "%%abcm2ps-index %ld %ld %ld\n",
+		(long) sbuf.st_mtime, (long) sbuf.st_size,
+		hint ? (long) (hint - file) : -1L);
+
+	t = NULL;			/* start of the current tune */
+	g = file;			/* start of the global part */
+	nl = begin = ntunes = 0;
+	for (p = file; ; ) {
+		s = p;
+		l = strcspn(s, "\r\n");
+		p += l;
+		if (*p != '\0') {
+			p++;
+			if (p[-1] == '\r' && *p == '\n')
+				p++;
+		}
+		if (t) {			/* in tune */
+			if (l == 0) {		/* end of tune */
+				l = tune_hdr_len((unsigned char *) t);
+				if (l < 0)
+					l = strcspn(t, "\r\n");
+				fprintf(fidx, "%ld %ld %d %d %d\n",
+					(long) (t - file), (long) (s - t),
+					nl, (int) (t - g), l);
+				fwrite(g, 1, t - g, fidx);
+				fwrite(t, 1, l, fidx);
+				fputc('\n', fidx);
+				ntunes++;
+				t = NULL;
+				g = s;
+			} else {
+				nl++;
+			}
+		} else if (s[0] == '%' && s[1] == '%') {
+			if (strncmp(s + 2, "begin", 5) == 0)
+				begin = 1;
+			else if (strncmp(s + 2, "end", 3) == 0)
+				begin = 0;
+		} else if (s[0] == 'X' && s[1] == ':' && !begin) {
+			t = s;
+			nl = 1;
+		}
+		if (*s == '\0')
+			break;
+	}
+	fprintf(fidx, "%ld 0 0 %d 0\n",
+		(long) (s - file), (int) (s - g));
+	fwrite(g, 1, s - g, fidx);
+	fputc('\n', fidx);
+	fclose(fidx);
+	if (!quiet)
+		printf("Index written on %s (%d tunes)\n", fnidx, ntunes);
+	free_file(file, msize);
+}
+
+/* -- profiling -- */
+/* With --profile, the time, the number of calls and the arena
+ * allocations are counted per generation phase. The times are
+ * inclusive (output_music contains cut_tune...) and a tune gets
+ * everything done since the end of the previous tune.
+ * The result is written in JSON at the end of the run. */
+static const char *prof_nm[PROF_NB] = {
+	"parse", "do_tune", "sort_all", "set_bar_num", "output_music",
+	"combine_voices", "set_beams", "set_stems", "set_overlap",
+	"set_allsymwidth", "cut_tune", "draw_sym_near", "draw_systems",
+	"draw_all_symb", "draw_all_deco", "write_buffer", "svg_write"
+};
+struct prof_ph {
+	long long ns;
+	long long arena;
+	int calls;
+};
+static struct prof_tune {
+	char *fn;
+	char *x;
+	char *title;
+	int cached;		/* from the render cache */
+	struct prof_ph ph[PROF_NB];
+} *prof_tb;
+static int prof_n, prof_max;
+static struct prof_ph prof_cur[PROF_NB];
+static long long prof_t0[PROF_NB], prof_a0[PROF_NB];
+static int prof_depth[PROF_NB];
+
+static long long prof_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#else
+	return clock() * (1000000000LL / CLOCKS_PER_SEC);
+#endif
+}
+
+void prof_begin(int ph)
+{
+	if (!profile || prof_depth[ph]++ != 0)
+		return;
+	prof_a0[ph] = arena_sz;
+	prof_t0[ph] = prof_now();
+}
+
+void prof_end(int ph)
+{
+	if (!profile || --prof_depth[ph] != 0)
+		return;
+	prof_cur[ph].ns += prof_now() - prof_t0[ph];
+	prof_cur[ph].arena += arena_sz - prof_a0[ph];
+	prof_cur[ph].calls++;
+}
+
+/* -- end of tune: keep its counters -- */
+void prof_tune(struct SYMBOL *x, struct SYMBOL *t, int cached)
+{
+	struct prof_tune *pt;
+	static char *fn;
+
+	if (!profile)
+		return;
+	if (prof_n >= prof_max) {
+		prof_max = prof_max ? prof_max * 2 : 64;
+		prof_tb = realloc(prof_tb, prof_max * sizeof *prof_tb);
+		if (!prof_tb) {
+			error(1, NULL, "Out of memory for the profile - abort");
+			exit(EXIT_FAILURE);
+		}
+	}
+	pt = &prof_tb[prof_n++];
+	if (x->fn && (!fn || strcmp(fn, x->fn) != 0))
+		fn = strdup(x->fn);
+	pt->fn = fn;
+	pt->x = strdup(&x->text[2]);
+	pt->title = t ? strdup(&t->text[2]) : NULL;
+	pt->cached = cached;
+	memcpy(pt->ph, prof_cur, sizeof pt->ph);
+	memset(prof_cur, 0, sizeof prof_cur);
+}
+
+static void prof_str(FILE *f, char *p)
+{
+	unsigned char c;
+
+	putc('"', f);
+	while ((c = *p++) != '\0') {
+		if (c == '"' || c == '\\')
+			fprintf(f, "\\%c", c);
+		else if (c < ' ')
+			fprintf(f, "\\u%04x", c);
+		else
+			putc(c, f);
+	}
+	putc('"', f);
+}
+
+static void prof_phases(FILE *f, struct prof_ph *ph)
+{
+	int i;
+	char *sep;
+
+	sep = "";
+	putc('{', f);
+	for (i = 0; i < PROF_NB; i++) {
+		if (ph[i].calls == 0)
+			continue;
+		fprintf(f, "%s\"%s\":{\"ns\":%lld,\"calls\":%d,\"arena\":%lld}",
+			sep, prof_nm[i], ph[i].ns, ph[i].calls, ph[i].arena);
+		sep = ",";
+	}
+	putc('}', f);
+}
+
+/* -- write the profile -- */
+static void prof_write(char *fn)
+{
+	FILE *f;
+	struct prof_tune *pt;
+	struct prof_ph tot[PROF_NB];
+	int i, j;
+
+	if (!fn || strcmp(fn, "-") == 0) {
+		f = stderr;
+	} else if ((f = fopen(fn, "w")) == NULL) {
+		error(1, NULL, "Cannot create the profile file %s", fn);
+		return;
+	}
+	memcpy(tot, prof_cur, sizeof tot);	/* (outside the tunes) */
+	fprintf(f, "{\"version\":\"%s\",\n \"tunes\":[", VERSION);
+	for (i = 0, pt = prof_tb; i < prof_n; i++, pt++) {
+		fprintf(f, "%s\n  {\"file\":", i == 0 ? "" : ",");
+		prof_str(f, pt->fn ? pt->fn : "");
+		fputs(",\"X\":", f);
+		prof_str(f, pt->x);
+		fputs(",\"title\":", f);
+		prof_str(f, pt->title ? pt->title : "");
+		if (pt->cached)
+			fputs(",\"cached\":true", f);
+		fputs(",\"phases\":", f);
+		prof_phases(f, pt->ph);
+		putc('}', f);
+		for (j = 0; j < PROF_NB; j++) {
+			tot[j].ns += pt->ph[j].ns;
+			tot[j].arena += pt->ph[j].arena;
+			tot[j].calls += pt->ph[j].calls;
+		}
+	}
+	fputs("],\n \"total\":", f);
+	prof_phases(f, tot);
+	fprintf(f, ",\n \"width_cache\":{\"hit\":%d,\"miss\":%d}",
+		texw_hit, texw_miss);
+	fprintf(f, ",\n \"svg_heap\":{\"pages\":%d,\"alloc\":%d}",
+		svg_npages, svg_nalloc);
+	fprintf(f, ",\n \"render_cache\":{\"hit\":%d,\"miss\":%d,"
+			"\"store\":%d,\"evict\":%d}}\n",
+		rcache_hit, rcache_miss, rcache_store, rcache_evict);
+	if (f != stderr)
+		fclose(f);
+}
+
+/* -- generate the tunes of an ABC file in parallel -- */
+/* Each child process generates one tune out of 'njobs'.
+ * Meanwhile, the parent process treats the global definitions
+ * and skips all tunes, so that its state is the same as if
+ * it had generated the file. */
+static void frontend_jobs(char *file, char *abc_fn)
+{
+#if defined(unix) || defined(__unix__)
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+	fflush(stderr);
+	for (ijob = 0; ijob < njobs; ijob++) {
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			break;
+		}
+		if (pid == 0) {
+			frontend((unsigned char *) file, FE_ABC, abc_fn, 0);
+			if (profile) {
+				char fn[FILENAME_MAX];
+
+				if (prof_fn) {
+					snprintf(fn, sizeof fn, "%s.%d",
+						prof_fn, ijob);
+					prof_write(fn);
+				} else {
+					prof_write(NULL);
+				}
+			}
+			fflush(stdout);
+			fflush(stderr);
+			_exit(severity == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+	frontend((unsigned char *) file, FE_ABC, abc_fn, 0);	/* ijob >= njobs */
+	while (wait(&status) > 0) {
+		if (!WIFEXITED(status)
+		 || WEXITSTATUS(status) != EXIT_SUCCESS)
+			severity = 1;
+	}
+	ijob = 0;
+#else
+	frontend((unsigned char *) file, FE_ABC, abc_fn, 0);
+#endif
+}
+
 /* -- treat an input file and generate the ABC file -- */
 static void treat_file(char *fn, char *ext)
 {
 	char *file;
 	char *abc_fn;
+	size_t msize;
 	int file_type, l;
 
 	/* initialize if not already done */
@@ -211,7 +688,7 @@ static void treat_file(char *fn, char *ext)
 
 	/* read the file into memory */
 	/* the real/full file name is put in tex_buf[] */
-	if ((file = read_file(fn, ext)) == NULL) {
+	if ((file = read_file(fn, ext, &msize)) == NULL) {
 		if (strcmp(fn, "default.fmt") != 0) {
 			error(1, NULL, "Cannot read the input file '%s'", fn);
 #if defined(unix) || defined(__unix__)
@@ -237,9 +714,12 @@ static void treat_file(char *fn, char *ext)
 		mtime = fmtime;
 	}
 
-	frontend((unsigned char *) file, file_type,
+	if (file_type == FE_ABC && njobs > 1)
+		frontend_jobs(file, abc_fn);
+	else
+		frontend((unsigned char *) file, file_type,
 				abc_fn, 0);
-	free(file);
+	free_file(file, msize);
 
 	if (file_type == FE_PS)			/* PostScript file */
 		frontend((unsigned char *) "%%endps", FE_ABC,
@@ -272,10 +752,15 @@ static void treat_abc_file(char *fn)
 	char *abc_fn, *p, *q;
 	size_t fsize, l, l2;
 	int linenum;
+	char c;
 #ifdef HAVE_MMAP
 	int fd;
 #endif
 
+	if (build_index) {
+		index_build(fn);
+		return;
+	}
 	lvlarena(0);
 	parse.abc_state = ABC_S_GLOBAL;
 
@@ -300,8 +785,8 @@ static void treat_abc_file(char *fn)
 	rewind(fin);
 #ifdef HAVE_MMAP
 	fd = fileno(fin);
-	file = mmap(NULL, fsize, PROT_READ, MAP_PRIVATE, fd, 0);
-	if (!file)
+	file = mmap(NULL, fsize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (file == MAP_FAILED)
 		goto err;
 #else
 	file = malloc(fsize);
@@ -357,19 +842,27 @@ static void treat_abc_file(char *fn)
 		}
 		q++;
 
-		/* must copy ... :( */
+		/* the ABC sequence is terminated in place
+		 * (the file is private and writable) */
 		l2 = q - p;
-		file_tmp = malloc(l2 + 1);
-		if (!file_tmp) {
-			error(1, NULL, "out of memory");
-			break;
-		}
-		memcpy(file_tmp, p, l2);
-		file_tmp[l2] = '\0';
-
-		frontend((unsigned char *) file_tmp, FE_ABC,
+		if (l2 < l) {
+			c = *q;
+			*q = '\0';
+			frontend((unsigned char *) p, FE_ABC,
+						abc_fn, linenum);
+			*q = c;
+		} else {
+			file_tmp = malloc(l + 1);
+			if (!file_tmp) {
+				error(1, NULL, "out of memory");
+				break;
+			}
+			memcpy(file_tmp, p, l);
+			file_tmp[l] = '\0';
+			frontend((unsigned char *) file_tmp, FE_ABC,
 						abc_fn, linenum);
-		free(file_tmp);
+			free(file_tmp);
+		}
 
 		clrarena(1);			/* clear previous tunes */
 		file_initialized = -1;	/* don't put <br/> before first image */
@@ -402,6 +895,153 @@ static void read_def_format(void)
 	treat_file("default.fmt", "fmt");
 }
 
+#if defined(unix) || defined(__unix__)
+/* -- read exactly 'len' bytes from the standard input -- */
+/* (raw read: the stdio buffer of stdin must stay empty for the children) */
+static int read_in(char *buf, int len)
+{
+	int n;
+
+	while (len > 0) {
+		n = read(0, buf, len);
+		if (n <= 0)
+			return -1;
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* -- convert one job in a child process -- */
+static void serve_job(char *abc)
+{
+	in_fname = "";
+	frontend((unsigned char *) abc, FE_ABC, "stdin", 0);
+	if (multicol_start != 0) {
+		error(1, NULL, "Lack of %%%%multicol end");
+		multicol_start = 0;
+		buffer_eob(0);
+		if (!info['X' - 'A'])
+			write_buffer();
+	}
+	close_output_file();
+	fflush(stdout);
+	_exit(severity == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/* -- persistent mode -- */
+/* The jobs are read from stdin, each one as a line '<length>\n'
+ * followed by <length> bytes of ABC source. A null length or EOF ends.
+ * Each result is sent to stdout as a line '<length> <status>\n'
+ * followed by <length> bytes of PS/SVG.
+ * The conversion is done in a child process which inherits the
+ * initialized state (formats, decorations, fonts..), so that nothing
+ * has to be reset between the jobs. */
+static int serve_loop(void)
+{
+	char hd[32], *abc, *out, *p;
+	int i, len, fd[2], outsz, outlen, n, status;
+	pid_t pid;
+
+	if (epsf == 1 || epsf == 3) {
+		error(1, NULL, "Cannot use '-E' or '-z' with '--serve'");
+		return EXIT_FAILURE;
+	}
+	read_def_format();
+	outsz = 0x10000;
+	out = malloc(outsz);
+	if (!out) {
+		error(1, NULL, "Out of memory for the job output");
+		return EXIT_FAILURE;
+	}
+	for (;;) {
+
+		/* get the job */
+		for (i = 0; ; i++) {
+			if (read_in(&hd[i], 1) < 0)
+				goto out;
+			if (hd[i] == '\n')
+				break;
+			if (i >= sizeof hd - 1) {
+				error(1, NULL, "Job header too long");
+				free(out);
+				return EXIT_FAILURE;
+			}
+		}
+		hd[i] = '\0';
+		len = atoi(hd);
+		if (len <= 0)
+			break;
+		abc = malloc(len + 1);
+		if (!abc) {
+			error(1, NULL, "Out of memory for the job (%d bytes)", len);
+			free(out);
+			return EXIT_FAILURE;
+		}
+		if (read_in(abc, len) < 0) {
+			error(1, NULL, "Truncated job");
+			free(abc);
+			break;
+		}
+		abc[len] = '\0';
+
+		/* convert it */
+		fflush(stdout);
+		fflush(stderr);
+		if (pipe(fd) < 0
+		 || (pid = fork()) < 0) {
+			perror("serve");
+			return EXIT_FAILURE;
+		}
+		if (pid == 0) {
+			close(fd[0]);
+			dup2(fd[1], 1);
+			close(fd[1]);
+			serve_job(abc);		/* no return */
+		}
+		close(fd[1]);
+		free(abc);
+
+		/* send back the result */
+		outlen = 0;
+		for (;;) {
+			if (outlen >= outsz) {
+				p = realloc(out, outsz * 2);
+				if (!p) {
+					error(1, NULL,
+						"Out of memory for the job output");
+					close(fd[0]);	/* (the child gets SIGPIPE) */
+					waitpid(pid, &status, 0);
+					free(out);
+					return EXIT_FAILURE;
+				}
+				out = p;
+				outsz *= 2;
+			}
+			n = read(fd[0], out + outlen, outsz - outlen);
+			if (n <= 0)
+				break;
+			outlen += n;
+		}
+		close(fd[0]);
+		waitpid(pid, &status, 0);
+		printf("%d %d\n", outlen,
+			WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+		fwrite(out, 1, outlen, stdout);
+		fflush(stdout);
+	}
+out:
+	free(out);
+	return EXIT_SUCCESS;
+}
+#else
+static int serve_loop(void)
+{
+	error(1, NULL, "'--serve' is not supported on this system");
+	return EXIT_FAILURE;
+}
+#endif
+
 /* -- set extension on a file name -- */
 void strext(char *fn, char *ext)
 {
@@ -460,7 +1100,8 @@ static void usage(void)
 		"     -O fff  set outfile name to fff\n"
 		"     -O =    make outfile name from infile/title\n"
 		"     -i      indicate where are the errors\n"
-		"     -k kk   size of the PS output buffer in Kibytes\n"
+		"     -k kk   initial size of the output buffer in Kibytes\n"
+		"     -J n    generate the tunes in n parallel jobs (-E and -g)\n"
 		"  .output formatting:\n"
 		"     -s xx   set scale factor to xx\n"
 		"     -w xx   set staff width (cm/in/pt)\n"
@@ -495,6 +1136,16 @@ static void usage(void)
 		"     -h      show this command summary\n"
 		"     -H      show the format parameters\n"
 		"     -S      secure mode\n"
+		"     --serve convert the length-prefixed ABC jobs read from stdin\n"
+		"     --build-index\n"
+		"             create the tune indexes of the ABC files\n"
+		"     --profile[=file]\n"
+		"             write the time spent in the generation phases (JSON)\n"
+		"     --shared-defs\n"
+		"             define the SVG symbols once per document (-X and -z)\n"
+		"     --cache=dir[,size]\n"
+		"             keep the output of the tunes in the directory 'dir'\n"
+		"             (max size in MB - default 64)\n"
 		"     -q      quiet mode\n");
 	exit(EXIT_SUCCESS);
 }
@@ -596,6 +1247,29 @@ int main(int argc, char **argv)
 		if (*p != '-' || p[1] == '-') {
 			if (*p == '+' && p[1] == 'F')	/* +F : no default format */
 				def_fmt_done = 1;
+			else if (strcmp(p, "--build-index") == 0)
+				build_index = 1;
+			else if (strcmp(p, "--shared-defs") == 0)
+				shared_defs = 1;
+			else if (strncmp(p, "--profile", 9) == 0
+			      && (p[9] == '\0' || p[9] == '=')) {
+				profile = 1;
+				if (p[9] == '=')
+					prof_fn = p + 10;
+			} else if (strncmp(p, "--cache=", 8) == 0) {
+				char *q;
+
+				rcache_dir = p + 8;
+				q = strrchr(rcache_dir, ',');
+				if (q) {
+					*q++ = '\0';
+					rcache_max = atol(q) << 20;
+				}
+			} else if (strcmp(p, "--serve") == 0) {
+				serve = 1;
+				quiet = 1;	/* stdout is the job channel */
+				strcpy(outfn, "-");
+			}
 			continue;
 		}
 		while ((c = *++p) != '\0') {	/* '-xxx' */
@@ -651,6 +1325,19 @@ int main(int argc, char **argv)
 				init_outbuf(kbsz);
 				break;
 			    }
+			case 'J':
+				if (p[1] == '\0') {
+					if (--argc <= 0) {
+						error(1, NULL, "No value for '-J' - aborting");
+						return EXIT_FAILURE;
+					}
+					aaa = *++argv;
+				} else {
+					aaa = p + 1;
+					p += strlen(p) - 1;
+				}
+				sscanf(aaa, "%d", &njobs);
+				break;
 			case 'O':
 				if (p[1] == '\0') {
 					if (--argc <= 0) {
@@ -681,6 +1368,9 @@ int main(int argc, char **argv)
 	}
 	if (!quiet)
 		display_version(0);
+	if (njobs > 1
+	 && (epsf == 0 || epsf == 3 || strcmp(outfn, "-") == 0))
+		njobs = 0;		/* the tunes are not independent */
 
 	/* initialize */
 	clrarena(0);				/* global */
@@ -691,6 +1381,8 @@ int main(int argc, char **argv)
 	notitle.text = "T:";
 	set_format();
 	init_deco();
+	if (svg || epsf > 1)
+		be = &svg_be;		/* direct SVG output */
 
 #ifdef linux
 	/* if not set, try to find where is the default format directory */
@@ -822,6 +1514,13 @@ int main(int argc, char **argv)
 		if (c == '-') {		     /* interpret a flag with '-' */
 			if (p[1] == '-') {		/* long argument */
 				p += 2;
+				if (strcmp(p, "serve") == 0
+				 || strcmp(p, "build-index") == 0
+				 || strcmp(p, "shared-defs") == 0
+				 || strncmp(p, "cache=", 6) == 0
+				 || (strncmp(p, "profile", 7) == 0
+				  && (p[7] == '\0' || p[7] == '=')))
+					continue;
 				if (--argc <= 0) {
 					error(1, NULL, "No argument for '--'");
 					return EXIT_FAILURE;
@@ -911,6 +1610,7 @@ int main(int argc, char **argv)
 				case 'e':
 				case 'F':
 				case 'I':
+				case 'J':
 				case 'j':
 				case 'k':
 				case 'L':
@@ -933,7 +1633,7 @@ int main(int argc, char **argv)
 						p += strlen(p) - 1;	/* stop */
 					}
 
-					if (strchr("BbfjkNs", c)) {	/* check num args */
+					if (strchr("BbfJjkNs", c)) {	/* check num args */
 						for (j = 0; j < strlen(aaa); j++) {
 							if (!strchr("0123456789.",
 								    aaa[j])) {
@@ -983,6 +1683,7 @@ int main(int argc, char **argv)
 							cfmt.measurebox = 0;
 						lock_fmt(&cfmt.measurebox);
 						break;
+					case 'J':
 					case 'k':
 						break;
 					case 'm':
@@ -1037,6 +1738,11 @@ int main(int argc, char **argv)
 		in_fname = p;
 	}
 
+	if (serve) {
+		if (in_fname)
+			error(1, NULL, "Input file ignored with '--serve'");
+		return serve_loop();
+	}
 	if (in_fname)
 		treat_abc_file(in_fname);
 	if (multicol_start != 0) {		/* lack of %%multicol end */
@@ -1047,11 +1753,13 @@ int main(int argc, char **argv)
 		 && !epsf)
 			write_buffer();
 	}
-	if (!epsf && !fout) {
+	if (!epsf && !fout && !build_index) {
 		error(1, NULL, "Nothing to generate!");
 		return EXIT_FAILURE;
 	}
 	close_output_file();
+	if (profile)
+		prof_write(prof_fn);
 	return severity == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -1111,6 +1819,7 @@ void *getarena(int len)
 		a_p->p = a_p->str;
 		a_p->r = a_p->sz;
 	}
+	arena_sz += len;
 	p = a_p->p;
 	a_p->p += len;
 	a_p->r -= len;
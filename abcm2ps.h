@@ -5,12 +5,14 @@
 
 #include "config.h"
 
-#define MAXVOICE 32	/* max number of voices */
+#ifndef MAXVOICE
+#define MAXVOICE 128	/* max number of voices (<= 128: signed char) */
+#endif
 
 #define MAXHD	8	/* max heads in a chord */
 #define MAXDC	32	/* max decorations per symbol */
 #define MAXMICRO 32	/* max microtone values (5 bits in accs[]) */
-#define DC_NAME_SZ 128	/* size of the decoration name table */
+#define DC_NAME_SZ 512	/* size of the decoration name table */
 
 #define BASE_LEN 1536	/* basic note length (semibreve or whole note - same as MIDI) */
 
@@ -117,7 +119,9 @@ enum accidentals {
 /* -- macros for program internals -- */
 
 #define STRL1		256	/* string length for file names */
-#define MAXSTAFF	32	/* max staves */
+#ifndef MAXSTAFF
+#define MAXSTAFF	128	/* max staves (<= 128: signed char) */
+#endif
 #define BSIZE		512	/* buffer size for one input string */
 
 #define BREVE		(BASE_LEN * 2)	/* double note (square note) */
@@ -136,12 +140,14 @@ enum accidentals {
 #define T_SKIP		4
 #define T_RIGHT		5
 
-#define YSTEP	128		/* number of steps for y offsets */
+#define YSTEP	128		/* min number of steps for y offsets */
+#define YSTEPMAX 1024		/* max number of steps for y offsets */
+#define YSTEPW	5.5		/* min width of a y offset step */
 
 struct decos {		/* decorations */
 	char n;			/* whole number of decorations */
 	struct {
-		unsigned char t;	/* decoration index */
+		unsigned short t;	/* decoration index */
 		signed char m;		/* index in chord when note / -1 */
 	} tm[MAXDC];
 };
@@ -202,6 +208,8 @@ struct FONTSPEC {
 	float swfac;
 };
 extern char *fontnames[MAXFONTS];	/* list of font names */
+extern char used_font[MAXFONTS];	/* fonts to be defined in the PS prolog */
+extern int nfontnames;			/* number of fonts */
 
 /* lyrics */
 #define LY_HYPH	0x10	/* replacement character for hyphen */
@@ -241,23 +249,9 @@ struct posit_s {
 
 /* music element */
 struct SYMBOL { 		/* struct for a drawable symbol */
-	struct SYMBOL *abc_next, *abc_prev; /* source linkage */
-	struct SYMBOL *next, *prev;	/* voice linkage */
+	/* the fields used by the layout loops (music.c) are grouped
+	 * here, in less than a cache line */
 	struct SYMBOL *ts_next, *ts_prev; /* time linkage */
-	struct SYMBOL *extra;	/* extra symbols (grace notes, tempo... */
-	char abc_type;		/* ABC symbol type */
-#define ABC_T_NULL	0
-#define ABC_T_INFO 	1		/* (text[0] gives the info type) */
-#define ABC_T_PSCOM	2
-#define ABC_T_CLEF	3
-#define ABC_T_NOTE	4
-#define ABC_T_REST	5
-#define ABC_T_BAR	6
-#define ABC_T_EOLN	7
-#define ABC_T_MREST	8		/* multi-measure rest */
-#define ABC_T_MREP	9		/* measure repeat */
-#define ABC_T_V_OVER	10		/* voice overlay */
-#define ABC_T_TUPLET	11
 	unsigned char type;	/* symbol type */
 #define NO_TYPE		0	/* invalid type */
 #define NOTEREST	1	/* valid symbol types */
@@ -279,9 +273,6 @@ struct SYMBOL { 		/* struct for a drawable symbol */
 	unsigned char voice;	/* voice (0..nvoice) */
 	unsigned char staff;	/* staff (0..nstaff) */
 	unsigned char nhd;	/* number of notes in chord - 1 */
-	signed char pits[MAXHD]; /* pitches / clef */
-	int dur;		/* main note duration */
-	int time;		/* starting time */
 	unsigned int sflags;	/* symbol flags */
 #define S_EOLN		0x0001		/* end of line */
 #define S_BEAM_ST	0x0002		/* beam starts here */
@@ -312,6 +303,30 @@ struct SYMBOL { 		/* struct for a drawable symbol */
 #define S_SHIFTUNISON_2	0x04000000	/* %%shiftunison 2 */
 #define S_NEW_SY	0x08000000	/* staff system change (%%staves) */
 #define S_RBSTART	0x10000000	// start of repeat bracket
+	int dur;		/* main note duration */
+	int time;		/* starting time */
+	float x;		/* x offset */
+	float wl, wr;		/* left, right min width */
+	float space;		/* natural space before symbol */
+	float shrink;		/* minimum space before symbol */
+	float xmax;		/* max x offset */
+	struct SYMBOL *abc_next, *abc_prev; /* source linkage */
+	struct SYMBOL *next, *prev;	/* voice linkage */
+	struct SYMBOL *extra;	/* extra symbols (grace notes, tempo... */
+	char abc_type;		/* ABC symbol type */
+#define ABC_T_NULL	0
+#define ABC_T_INFO 	1		/* (text[0] gives the info type) */
+#define ABC_T_PSCOM	2
+#define ABC_T_CLEF	3
+#define ABC_T_NOTE	4
+#define ABC_T_REST	5
+#define ABC_T_BAR	6
+#define ABC_T_EOLN	7
+#define ABC_T_MREST	8		/* multi-measure rest */
+#define ABC_T_MREP	9		/* measure repeat */
+#define ABC_T_V_OVER	10		/* voice overlay */
+#define ABC_T_TUPLET	11
+	signed char pits[MAXHD]; /* pitches / clef */
 	struct posit_s posit;	/* positions / directions */
 	signed char stem;	/* 1 / -1 for stem up / down */
 	signed char combine;	/* voice combine */
@@ -342,17 +357,12 @@ struct SYMBOL { 		/* struct for a drawable symbol */
 					 *	      # notes/rests if < 0
 					 *	nohdi1: # repeat */
 	int color;
-	float x;		/* x offset */
 	signed char y;		/* y offset of note head */
 	signed char ymn, ymx;	/* min, max, note head y offset */
 	signed char mid;	// y offset of the staff middle line
 	float xmx;		/* max h-pos of a head rel to top
 				 * width when STBRK */
 	float xs, ys;		/* coord of stem end / bar height */
-	float wl, wr;		/* left, right min width */
-	float space;		/* natural space before symbol */
-	float shrink;		/* minimum space before symbol */
-	float xmax;		/* max x offset */
 	struct gch *gch;	/* guitar chords / annotations */
 	struct lyrics *ly;	/* lyrics */
 
@@ -462,7 +472,7 @@ struct SYMBOL { 		/* struct for a drawable symbol */
 		struct notes note;	/* note, rest */
 		struct {		/* user defined accent */
 			unsigned char symbol;
-			unsigned char value;
+			unsigned short value;
 		} user;
 		struct {
 			char type;	/* 0: end of line
@@ -530,7 +540,7 @@ struct FORMAT { 		/* struct for page layout */
 	int combinevoices, contbarnb, continueall, custos;
 	int dblrepbar, decoerr, dynalign, flatbeams, infoline;
 	int gchordbox, graceslurs, graceword,gracespace, hyphencont;
-	int keywarn, landscape, linewarn;
+	int keywarn, landscape, linebreakalgo, linewarn;
 	int measurebox, measurefirst, measurenb, micronewps;
 	int oneperpage;
 #ifdef HAVE_PANGO
@@ -582,8 +592,30 @@ extern int annotate;		/* output source references */
 extern int pagenumbers; 	/* write page numbers */
 extern int epsf;		/* 1: EPSF, 2: SVG, 3: embedded ABC */
 extern int svg;			/* 1: SVG, 2: XHTML */
+extern int shared_defs;		/* one <defs> per XHTML/HTML document */
 extern int showerror;		/* show the errors */
 extern int pipeformat;		/* format for bagpipes */
+extern int njobs;		/* number of parallel jobs (-E/-g) */
+extern int profile;		/* --profile: time the generation phases */
+#define PROF_PARSE	0	/* phases */
+#define PROF_TUNE	1
+#define PROF_SORT	2
+#define PROF_BARNB	3
+#define PROF_MUSIC	4
+#define PROF_COMBINE	5
+#define PROF_BEAMS	6
+#define PROF_STEMS	7
+#define PROF_OVERLAP	8
+#define PROF_WIDTH	9
+#define PROF_CUT	10
+#define PROF_NEAR	11
+#define PROF_SYSTEMS	12
+#define PROF_SYMB	13
+#define PROF_DECO	14
+#define PROF_WRITE	15
+#define PROF_SVG	16
+#define PROF_NB		17
+extern int ijob;		/* index of the current job */
 
 extern char outfn[FILENAME_MAX]; /* output file name */
 extern char *in_fname;		/* current input file name */
@@ -624,7 +656,7 @@ struct STAFF_S {
 	float staffscale;
 	short botbar, topbar;	/* bottom and top of bar */
 	float y;		/* y position */
-	float top[YSTEP], bot[YSTEP];	/* top/bottom y offsets */
+	float top[YSTEPMAX], bot[YSTEPMAX]; /* top/bottom y offsets */
 };
 extern struct STAFF_S staff_tb[MAXSTAFF];
 extern int nstaff;		/* (0..MAXSTAFF-1) */
@@ -690,6 +722,7 @@ extern struct VOICE_S *first_voice; /* first_voice */
 extern struct SYMBOL *tsfirst;	/* first symbol in the time linked list */
 extern struct SYMBOL *tsnext;	/* next line when cut */
 extern float realwidth;		/* real staff width while generating */
+extern int ystep;		/* number of steps for y offsets */
 
 #define NFLAGS_SZ 10		/* size of note flags tables */
 #define C_XFLAGS 5		/* index of crotchet in flags tables */
@@ -732,12 +765,41 @@ struct SYSTEM {			/* staff system */
 };
 extern struct SYSTEM *cursys;		/* current staff system */
 
+/* drawing operators which may be output without PostScript text */
+enum dop_e {
+	DOP_hd, DOP_Hd, DOP_HD, DOP_HDD, DOP_ghd,	/* note heads */
+	DOP_breve, DOP_longa,
+	DOP_r128, DOP_r64, DOP_r32, DOP_r16, DOP_r8,	/* rests */
+	DOP_r4, DOP_r2, DOP_r1, DOP_r0, DOP_r00,
+	DOP_hl, DOP_hl1, DOP_hl2, DOP_ghl,		/* ledger lines */
+	DOP_su, DOP_sd, DOP_gu, DOP_gd,			/* stems */
+	DOP_dt,						/* dot */
+	DOP_bar, DOP_thbar, DOP_dotbar,			/* measure bars */
+	NDOP
+};
+extern char *dop_tb[NDOP];		/* PostScript names of the operators */
+
+/* output backend (PostScript text or direct SVG) */
+struct backend {
+	void (*xy)(float x, float y);		/* x y for the next operator */
+	void (*op)(int op);			/* operator (DOP_xxx) */
+	void (*sym)(float x, float y, int op);	/* x y operator */
+	void (*dot)(float x, int y);		/* dot relative to the head */
+	void (*stem)(float h, int op);		/* stem from the head */
+	void (*bar)(float h, float x, float y, int op); /* measure bar */
+};
+extern struct backend *be;		/* current output backend */
+extern struct backend ps_be, svg_be;
+
 /* -- external routines -- */
 /* abcm2ps.c */
 void include_file(unsigned char *fn);
 void clrarena(int level);
 int lvlarena(int level);
 void *getarena(int len);
+void prof_begin(int ph);
+void prof_end(int ph);
+void prof_tune(struct SYMBOL *x, struct SYMBOL *t, int cached);
 void strext(char *fid, char *ext);
 /* abcparse.c */
 void abc_parse(char *p, char *fname, int linenum);
@@ -754,11 +816,14 @@ void a2b(char *fmt, ...)
 	__attribute__ ((format (printf, 1, 2)))
 #endif
 	;
+void b_put(char *p, int len);
+void emit_f(float v);
+void emit_xy(float x, float y);
+void emit_op(char *op);
 void block_put(void);
 void buffer_eob(int eot);
 void marg_init(void);
 void bskip(float h);
-void check_buffer(void);
 void init_outbuf(int kbsz);
 void close_output_file(void);
 void close_page(void);
@@ -771,6 +836,14 @@ extern int (*output)(FILE *out, const char *fmt, ...)
 #endif
 	;
 void write_eps(void);
+void skip_eps(void);
+extern char *rcache_dir;	/* --cache: render cache directory */
+extern long rcache_max;		/* max size of the render cache */
+extern int rcache_hit, rcache_miss, rcache_store, rcache_evict;
+void rcache_line(char *p, int r);
+int rcache_start(void);
+void rcache_end(void);
+void rcache_abort(void);
 /* deco.c */
 void deco_add(char *text);
 void deco_cnv(struct decos *dc, struct SYMBOL *s, struct SYMBOL *prev);
@@ -790,6 +863,7 @@ float tempo_width(struct SYMBOL *s);
 void write_tempo(struct SYMBOL *s,
 		int beat,
 		float sc);
+void y_init(void);
 float y_get(int staff,
 		int up,
 		float x,
@@ -836,6 +910,9 @@ void frontend(unsigned char *s,
 		int ftype,
 		char *fname,
 		int linenum);
+unsigned char *charset_hint(unsigned char *p);
+int tune_hdr_len(unsigned char *s);
+int tune_selected(unsigned char *s);
 /* glyph.c */
 char *glyph_out(char *p);
 void glyph_add(char *p);
@@ -877,8 +954,11 @@ void str_font(int ft);
 #define A_GCHEXP 6
 void str_out(char *p, int action);
 void put_str(char *str, int action);
+int fmetrics_load(int fnum, char *fn);
+int fmetrics_have(int fnum);
 float tex_str(char *s);
 extern char tex_buf[];	/* result of tex_str() */
+extern int texw_hit, texw_miss;	/* tex_str() width cache statistics */
 #define TEX_BUF_SZ 512
 char *trim_title(char *p, struct SYMBOL *title);
 void user_ps_add(char *s, char use);
@@ -898,6 +978,7 @@ int svg_output(FILE *out, const char *fmt, ...)
 	;
 void svg_write(char *buf, int len);
 void svg_close();
+extern int svg_nalloc, svg_npages;	/* SVG heap allocations (--profile) */
 /* syms.c */
 void define_font(char *name, int num, int enc);
 void define_symbols(void);
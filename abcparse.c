@@ -33,7 +33,10 @@ static struct SYMBOL *deco_cont; /* current symbol when d: / s: continuation */
 
 static int g_abc_vers, g_ulen, g_microscale;
 static char g_char_tb[128];
-static char *g_deco_tb[128];		/* global decoration names */
+static char *g_deco_tb[DC_NAME_SZ];	/* global decoration names */
+static unsigned short deco_htb[DC_NAME_SZ * 2],	/* decoration name indexes */
+		g_deco_htb[DC_NAME_SZ * 2];
+static int deco_ver, g_deco_ver;	/* change counters of the names */
 static unsigned short g_micro_tb[MAXMICRO]; /* global microtone values */
 
 static char *abc_fn;		/* current source file name */
@@ -156,12 +159,17 @@ static struct SYMBOL *abc_new(int type, char *text)
 /* -- parse an ABC line -- */
 void abc_parse(char *p, char *fname, int ln)
 {
+	int r;
+
 	abc_fn = fname;
 	linenum = ln;
 	abc_line = p;
 
 	/* parse the music line */
-	switch (parse_line(p)) {
+	prof_begin(PROF_PARSE);
+	r = parse_line(p);
+	prof_end(PROF_PARSE);
+	switch (r) {
 	case 2:				/* start of tune (X:) */
 		g_abc_vers = parse.abc_vers;
 		g_ulen = ulen;
@@ -169,7 +177,11 @@ void abc_parse(char *p, char *fname, int ln)
 
 		meter = 2;
 		memcpy(g_char_tb, char_tb, sizeof g_char_tb);
-		memcpy(g_deco_tb, parse.deco_tb, sizeof g_deco_tb);
+		if (deco_ver != g_deco_ver) {	/* new global names */
+			memcpy(g_deco_tb, parse.deco_tb, sizeof g_deco_tb);
+			memcpy(g_deco_htb, deco_htb, sizeof g_deco_htb);
+			g_deco_ver = deco_ver;
+		}
 		memcpy(g_micro_tb, parse.micro_tb, sizeof g_micro_tb);
 		break;
 	case 1:				/* end of tune */
@@ -182,7 +194,11 @@ void abc_parse(char *p, char *fname, int ln)
 		ulen = g_ulen;
 		microscale = g_microscale;
 		memcpy(char_tb, g_char_tb, sizeof g_char_tb);
-		memcpy(parse.deco_tb, g_deco_tb, sizeof parse.deco_tb);
+		if (deco_ver != g_deco_ver) {	/* new names in the tune */
+			memcpy(parse.deco_tb, g_deco_tb, sizeof parse.deco_tb);
+			memcpy(deco_htb, g_deco_htb, sizeof deco_htb);
+			deco_ver = g_deco_ver;
+		}
 		memcpy(parse.micro_tb, g_micro_tb, sizeof parse.micro_tb);
 		lvlarena(0);
 		if (dc.n > 0)
@@ -190,6 +206,8 @@ void abc_parse(char *p, char *fname, int ln)
 		dc.n = 0;
 		break;
 	}
+	if (rcache_dir)
+		rcache_line(p, r);
 }
 
 /* treat the end of file */
@@ -353,10 +371,10 @@ static char *parse_extra(char *p,
 
 /* -- parse a decoration 'xxx<decosep>' -- */
 static char *get_deco(char *p,
-		      unsigned char *p_dc)
+		      unsigned short *p_dc)
 {
 	char *q, sep, **t;
-	unsigned i, l;
+	unsigned h, i, l;
 
 	*p_dc = 0;
 	q = p;
@@ -379,17 +397,29 @@ static char *get_deco(char *p,
 	l = p - q;
 	if (*p == sep)
 		p++;
-	for (i = 1, t = &parse.deco_tb[1];
-	     *t && i < DC_NAME_SZ;
-	     i++, t++) {
-		if (strlen(*t) == l
-		 && strncmp(*t, q, l) == 0) {
+
+	/* search the name in the hash table */
+	h = 2166136261u;
+	for (i = 0; i < l; i++)
+		h = (h ^ (unsigned char) q[i]) * 16777619;
+	for (;;) {
+		h &= DC_NAME_SZ * 2 - 1;
+		i = deco_htb[h];
+		if (i == 0)
+			break;
+		t = &parse.deco_tb[i];
+		if (strncmp(*t, q, l) == 0 && (*t)[l] == '\0') {
 			*p_dc = i + 128;
 			return p;
 		}
+		h++;
 	}
 
 	/* new decoration */
+	for (i = 1, t = &parse.deco_tb[1];
+	     *t && i < DC_NAME_SZ;
+	     i++, t++)
+		;
 	if (i < DC_NAME_SZ) {
 //		if (parse.abc_state != ABC_S_GLOBAL)
 //			lvlarena(0);
@@ -398,6 +428,8 @@ static char *get_deco(char *p,
 //			lvlarena(1);
 		memcpy(*t, q, l);
 		(*t)[l] = '\0';
+		deco_htb[h] = i;
+		deco_ver++;
 		*p_dc = i + 128;
 	} else {
 		syntax("Too many decoration types", q);
@@ -1630,7 +1662,7 @@ static char *parse_deco(char *p,
 			 int m)			/* note index / -1 */
 {
 	int n;
-	unsigned char t;
+	unsigned short t;
 
 	n = deco->n;
 	for (;;) {
@@ -1654,7 +1686,7 @@ static char *parse_deco(char *p,
 static char *parse_decoline(char *p)
 {
 	struct SYMBOL *is;
-	unsigned char t;
+	unsigned short t;
 	int n;
 
 	if ((is = deco_cont) == NULL)
@@ -0,0 +1,489 @@
+/*
+ * Benchmark of abcm2ps.
+ *
+ * This file is part of abcm2ps.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/* The benchmark generates some synthetic ABC corpora in the directory
+ * 'bench.d' and converts them with each output mode of abcm2ps.
+ * The corpora are always the same (the pseudo random generator has
+ * a fixed seed).
+ * It reports the throughput in tunes/s and output bytes/s, and it fails
+ * when a throughput is lower than the threshold given in the file of
+ * the command line (see bench.thr).
+ * With '-s', it times the skyline range operations of the decorations
+ * (skyline.h) in their scalar and SIMD versions. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define SKY(f) f##_scalar
+#define SKY_SCALAR
+#include "skyline.h"
+#undef SKY
+#undef SKY_SCALAR
+#define SKY(f) f##_simd
+#include "skyline.h"
+#undef SKY
+
+#define WDIR "bench.d"
+
+static char *prog = "../abcm2ps";	/* relative to WDIR */
+static int nruns = 3;
+static unsigned rnd_v;
+
+/* -- pseudo random number (0..n-1) -- */
+static int rnd(int n)
+{
+	rnd_v = rnd_v * 1103515245 + 12345;
+	return (rnd_v >> 16) % n;
+}
+
+static const char *keys[] = {"C", "G", "D", "A", "F", "Bb", "Eb", "Am", "Em", "Dm"};
+static const char *gchords[] = {"C", "G7", "Am", "Dm", "F", "Em7", "Bb", "E7"};
+static const char *notes = "CDEFGABcdefgab";
+static const char *decos[] = {"!trill!", "!fermata!", "!f!", "!p!", "!>!",
+		"!mordent!", "!accent!", "!tenuto!", ".", "~", "!crescendo(!",
+		"!crescendo)!", "!segno!", "!coda!", "!upbow!", "!downbow!"};
+static const char *sylls[] = {"la", "lo", "ri", "ver", "sing", "the",
+		"ing", "and", "all", "o", "my"};
+
+/* -- generate a measure of 8 quavers -- */
+static void measure(FILE *f, int deco)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		if (deco) {
+			if (rnd(3) == 0)
+				fputs(decos[rnd(sizeof decos / sizeof decos[0])], f);
+			if (rnd(8) == 0)
+				fprintf(f, "\"^%s\"", sylls[rnd(6)]);
+			if (rnd(6) == 0) {
+				fprintf(f, "[%c%c%c]", notes[rnd(7)],
+					notes[rnd(7) + 2], notes[rnd(7) + 4]);
+				continue;
+			}
+		}
+		if (i == 0 && rnd(2) == 0)
+			fprintf(f, "\"%s\"", gchords[rnd(8)]);
+		putc(notes[rnd(14)], f);
+		if (i % 4 == 3)
+			putc(' ', f);
+	}
+	fputs("| ", f);
+}
+
+static void header(FILE *f, int x, char *title)
+{
+	fprintf(f, "X:%d\nT:%s %d\nM:4/4\nL:1/8\nK:%s\n",
+		x, title, x, keys[rnd(sizeof keys / sizeof keys[0])]);
+}
+
+/* many small tunes */
+static void gen_tunes(FILE *f, int n)
+{
+	int x, i;
+
+	for (x = 1; x <= n; x++) {
+		header(f, x, "Tune");
+		for (i = 0; i < 16; i++) {
+			measure(f, 0);
+			if (i % 4 == 3)
+				putc('\n', f);
+		}
+		putc('\n', f);
+	}
+}
+
+/* many voices */
+static void gen_voices(FILE *f, int n)
+{
+	int x, v, i;
+
+	for (x = 1; x <= n; x++) {
+		fprintf(f, "X:%d\nT:Voices %d\nM:4/4\nL:1/8\n%%%%score", x, x);
+		for (v = 0; v < 16; v += 2)
+			fprintf(f, " (V%d V%d)", v, v + 1);
+		fputs("\nK:C\n", f);
+		for (v = 0; v < 16; v++) {
+			fprintf(f, "V:V%d\n", v);
+			for (i = 0; i < 30; i++) {
+				measure(f, 0);
+				if (i % 3 == 2)
+					putc('\n', f);
+			}
+		}
+		putc('\n', f);
+	}
+}
+
+/* dense lyrics */
+static void gen_lyrics(FILE *f, int n)
+{
+	int x, i, j, k;
+
+	for (x = 1; x <= n; x++) {
+		header(f, x, "Song");
+		for (i = 0; i < 12; i++) {
+			for (j = 0; j < 2; j++)
+				measure(f, 0);
+			putc('\n', f);
+			for (k = 0; k < 3; k++) {
+				fputs("w:", f);
+				for (j = 0; j < 16; j++)
+					fprintf(f, " %s", sylls[rnd(10)]);
+				putc('\n', f);
+			}
+		}
+		putc('\n', f);
+	}
+}
+
+/* heavy decorations */
+static void gen_deco(FILE *f, int n)
+{
+	int x, i;
+
+	for (x = 1; x <= n; x++) {
+		header(f, x, "Deco");
+		for (i = 0; i < 24; i++) {
+			measure(f, 1);
+			if (i % 4 == 3)
+				putc('\n', f);
+		}
+		putc('\n', f);
+	}
+}
+
+/* long continuous pieces */
+static void gen_cont(FILE *f, int n)
+{
+	int x, i;
+
+	for (x = 1; x <= n; x++) {
+		header(f, x, "Piece");
+		fputs("%%continueall\n", f);
+		for (i = 0; i < 1500; i++) {
+			measure(f, 0);
+			if (i % 4 == 3)
+				putc('\n', f);
+		}
+		putc('\n', f);
+	}
+}
+
+/* many pseudo-comments and format parameters */
+static const char *fmts[] = {"staffsep 46", "sysstaffsep 34",
+		"maxshrink 0.65", "stretchlast 0.3", "notespacingfactor 1.4",
+		"measurenb 0", "gchordfont Helvetica 12", "titlefont Times 18",
+		"vocalfont Times-Roman 13", "annotationfont Helvetica 12",
+		"scale 0.75", "wordsspace 5", "musicspace 6", "composerspace 6",
+		"dynalign 1", "partsbox 0", "infoline 0", "graceslurs 1",
+		"stemheight 21", "beamslope 0.5", "slurheight 1.0",
+		"textfont Times-Roman 16", "vskip 6", "sep 4 4 200",
+		"staffbreak 10", "setbarnb 1", "repbra 1", "vocal up",
+		"dynamic down", "gstemdir up", "stemdir auto"};
+
+static void gen_fmt(FILE *f, int n)
+{
+	int x, i;
+
+	for (x = 1; x <= n; x++) {
+		header(f, x, "Directives");
+		for (i = 0; i < 8; i++) {
+			fprintf(f, "%%%%%s\n",
+				fmts[rnd(sizeof fmts / sizeof fmts[0])]);
+			fprintf(f, "%%%%%s\n",
+				fmts[rnd(sizeof fmts / sizeof fmts[0])]);
+			measure(f, 0);
+			measure(f, 0);
+			putc('\n', f);
+		}
+		putc('\n', f);
+	}
+}
+
+static struct corpus {
+	char *name;
+	void (*gen)(FILE *f, int n);
+	int ntunes;
+} corpus_tb[] = {
+	{"tunes", gen_tunes, 400},
+	{"voices", gen_voices, 10},
+	{"lyrics", gen_lyrics, 100},
+	{"deco", gen_deco, 100},
+	{"continue", gen_cont, 2},
+	{"directive", gen_fmt, 400},
+};
+#define NCORPUS (sizeof corpus_tb / sizeof corpus_tb[0])
+
+static struct mode {
+	char *name;
+	char *opts;
+	char *ext;		/* input file type */
+} mode_tb[] = {
+	{"ps", "-O out.ps", "abc"},
+	{"eps", "-E -O out", "abc"},
+	{"svg", "-g -O out", "abc"},
+	{"xhtml", "-X -O out.xhtml", "abc"},
+	{"embed", "-z -O out.html", "html"},
+};
+#define NMODE (sizeof mode_tb / sizeof mode_tb[0])
+
+static float thr_tb[NCORPUS][NMODE];	/* min tunes/s */
+
+/* -- generate a corpus as ABC and as HTML+ABC -- */
+static int gen_corpus(struct corpus *c)
+{
+	FILE *f;
+	char fn[64], *p;
+	long l;
+
+	rnd_v = 1;
+	sprintf(fn, WDIR "/%s.abc", c->name);
+	f = fopen(fn, "w");
+	if (!f)
+		return -1;
+	c->gen(f, c->ntunes);
+	fclose(f);
+
+	/* copy it into an HTML file with one <p> per tune */
+	f = fopen(fn, "r");
+	fseek(f, 0, SEEK_END);
+	l = ftell(f);
+	rewind(f);
+	p = malloc(l + 1);
+	if (!p || fread(p, 1, l, f) != (size_t) l) {
+		fclose(f);
+		return -1;
+	}
+	p[l] = '\0';
+	fclose(f);
+	sprintf(fn, WDIR "/%s.html", c->name);
+	f = fopen(fn, "w");
+	if (!f)
+		return -1;
+	fputs("<html>\n<body>\n", f);
+	{
+		char *q, *r;
+
+		for (q = p; *q != '\0'; q = r) {
+			r = strstr(q + 1, "\nX:");
+			r = r ? r + 1 : q + strlen(q);
+			fputs("<p>\n", f);
+			fwrite(q, 1, r - q, f);
+			fputs("</p>\n", f);
+		}
+	}
+	fputs("</body>\n</html>\n", f);
+	fclose(f);
+	free(p);
+	return 0;
+}
+
+/* -- remove the output files and return their total size -- */
+static long out_clean(void)
+{
+	DIR *d;
+	struct dirent *e;
+	struct stat sbuf;
+	char fn[300];
+	long sz;
+
+	sz = 0;
+	d = opendir(WDIR);
+	if (!d)
+		return 0;
+	while ((e = readdir(d)) != NULL) {
+		if (strncmp(e->d_name, "out", 3) != 0)
+			continue;
+		sprintf(fn, WDIR "/%.256s", e->d_name);
+		if (stat(fn, &sbuf) == 0)
+			sz += sbuf.st_size;
+		remove(fn);
+	}
+	closedir(d);
+	return sz;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* -- run get+set pairs of width n on a skyline -- */
+#define SKY_W 1024		/* YSTEPMAX */
+#define SKY_PAIRS 2000000
+static double sky_run(int simd, int n, float *top, float *bot)
+{
+	static short pos[4096];
+	float *p, y;
+	double t;
+	int i, k, up;
+
+	for (i = 0; i < SKY_W; i++) {
+		top[i] = 0;
+		bot[i] = 24;
+	}
+	rnd_v = 1;
+	for (i = 0; i < 4096; i++)
+		pos[i] = rnd(SKY_W - n + 1);
+	t = now();
+	for (k = 0; k < SKY_PAIRS; k++) {
+		i = pos[k & 4095];
+		up = k & 1;
+		p = up ? top : bot;
+		if (simd) {
+			y = y_range_simd(p + i, n, up);
+			y += up ? k % 3 : -(k % 3);
+			y_bound_simd(p, i, i + n - 1, y, up);
+		} else {
+			y = y_range_scalar(p + i, n, up);
+			y += up ? k % 3 : -(k % 3);
+			y_bound_scalar(p, i, i + n - 1, y, up);
+		}
+	}
+	return now() - t;
+}
+
+/* -- compare the scalar and SIMD skyline operations -- */
+static int sky_bench(void)
+{
+	static const int w_tb[] = {3, 16, 64, 256};
+	static float top[2][SKY_W], bot[2][SKY_W];
+	double ts, tv;
+	unsigned i;
+	int nfail;
+
+	printf("%d get+set pairs\n%5s %12s %12s\n",
+		SKY_PAIRS, "width", "scalar ns", "simd ns");
+	nfail = 0;
+	for (i = 0; i < sizeof w_tb / sizeof w_tb[0]; i++) {
+		ts = sky_run(0, w_tb[i], top[0], bot[0]);
+		tv = sky_run(1, w_tb[i], top[1], bot[1]);
+		printf("%5d %12.1f %12.1f", w_tb[i],
+			ts * 1e9 / SKY_PAIRS, tv * 1e9 / SKY_PAIRS);
+		if (memcmp(top[0], top[1], sizeof top[0]) != 0
+		 || memcmp(bot[0], bot[1], sizeof bot[0]) != 0) {
+			printf(" MISMATCH");
+			nfail++;
+		}
+		putchar('\n');
+	}
+	return nfail == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* -- read the thresholds -- */
+static void read_thr(char *fn)
+{
+	FILE *f;
+	char line[256], cn[32], mn[32];
+	float v;
+	unsigned i, j;
+
+	f = fopen(fn, "r");
+	if (!f) {
+		fprintf(stderr, "abcbench: cannot read %s\n", fn);
+		exit(EXIT_FAILURE);
+	}
+	while (fgets(line, sizeof line, f)) {
+		if (line[0] == '#'
+		 || sscanf(line, "%31s %31s %f", cn, mn, &v) != 3)
+			continue;
+		for (i = 0; i < NCORPUS; i++) {
+			if (strcmp(cn, corpus_tb[i].name) != 0)
+				continue;
+			for (j = 0; j < NMODE; j++) {
+				if (strcmp(mn, mode_tb[j].name) == 0)
+					thr_tb[i][j] = v;
+			}
+		}
+	}
+	fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+	char cmd[512];
+	double t, best;
+	float tps;
+	long sz;
+	unsigned i, j;
+	int r, nfail;
+
+	if (argc == 2 && strcmp(argv[1], "-s") == 0)
+		return sky_bench();
+	while (argc > 2 && argv[1][0] == '-') {
+		if (strcmp(argv[1], "-n") == 0) {
+			nruns = atoi(argv[2]);
+		} else if (strcmp(argv[1], "-p") == 0) {
+			prog = argv[2];
+		} else {
+			break;
+		}
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc != 2) {
+		fprintf(stderr,
+			"usage: abcbench [-n runs] [-p program] thresholds\n"
+			"       abcbench -s\n");
+		return EXIT_FAILURE;
+	}
+	read_thr(argv[1]);
+	mkdir(WDIR, 0755);
+	for (i = 0; i < NCORPUS; i++) {
+		if (gen_corpus(&corpus_tb[i]) < 0) {
+			fprintf(stderr, "abcbench: cannot create the corpus %s\n",
+				corpus_tb[i].name);
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("%-9s %-6s %9s %12s %9s\n",
+		"corpus", "mode", "tunes/s", "bytes/s", "min");
+	nfail = 0;
+	for (i = 0; i < NCORPUS; i++) {
+		for (j = 0; j < NMODE; j++) {
+			snprintf(cmd, sizeof cmd,
+				"cd " WDIR " && %s -q %s %s.%s >/dev/null 2>&1",
+				prog, mode_tb[j].opts, corpus_tb[i].name,
+				mode_tb[j].ext);
+			best = 0;
+			sz = 0;
+			for (r = 0; r < nruns; r++) {
+				t = now();
+				if (system(cmd) != 0) {
+					fprintf(stderr, "abcbench: '%s' failed\n",
+						cmd);
+					nfail++;
+				}
+				t = now() - t;
+				sz = out_clean();
+				if (r == 0 || t < best)
+					best = t;
+			}
+			tps = corpus_tb[i].ntunes / best;
+			printf("%-9s %-6s %9.1f %12.0f %9.1f%s\n",
+				corpus_tb[i].name, mode_tb[j].name,
+				tps, sz / best, thr_tb[i][j],
+				tps < thr_tb[i][j] ? " REGRESSION" : "");
+			if (tps < thr_tb[i][j])
+				nfail++;
+		}
+	}
+	return nfail == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
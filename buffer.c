@@ -16,18 +16,28 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#if defined(unix) || defined(__unix__)
+#include <unistd.h>
+#endif
 
 #include "abcm2ps.h" 
 
 #define PPI_96_72 0.75		// convert page format to 72 PPI
-#define BUFFLN	80		/* max number of lines in output buffer */
+#define BUFFLN	80		/* initial number of lines in output buffer */
 
 static int ln_num;		/* number of lines in buffer */
-static float ln_pos[BUFFLN];	/* vertical positions of buffered lines */
-static char *ln_buf[BUFFLN];	/* buffer location of buffered lines */
-static float ln_lmarg[BUFFLN];	/* left margin of buffered lines */
-static float ln_scale[BUFFLN];	/* scale of buffered lines */
-static signed char ln_font[BUFFLN];	/* font of buffered lines */
+static int ln_max;		/* size of the ln_xxx arrays */
+static float *ln_pos;		/* vertical positions of buffered lines */
+static int *ln_buf;		/* buffer offset of buffered lines */
+static float *ln_lmarg;		/* left margin of buffered lines */
+static float *ln_scale;		/* scale of buffered lines */
+static signed char *ln_font;	/* font of buffered lines */
 static float cur_lmarg = 0;	/* current left margin */
 static float min_lmarg, max_rmarg;	/* margins for -E/-g */
 static float cur_scale = 1.0;	/* current scale */
@@ -40,6 +50,16 @@ static int nbpages;		/* number of pages in the output file */
 static char outfnam[FILENAME_MAX]; /* internal file name for open/close */
 static struct FORMAT *p_fmt;	/* current format while treating a new page */
 
+/* render cache */
+char *rcache_dir;		/* --cache: cache directory */
+long rcache_max = 64L << 20;	/* max size of the cache */
+int rcache_hit, rcache_miss, rcache_store, rcache_evict;
+static int rc_st;		/* state */
+#define RC_NONE 0
+#define RC_REC 1			/* recording the output of a tune */
+static int rc_depth;		/* depth of the buffer calls */
+static void rc_call(int type, int eot);
+
 int (*output)(FILE *out, const char *fmt, ...);
 
 int in_page;			/* filling a PostScript page */
@@ -310,7 +330,7 @@ void close_output_file(void)
 }
 
 /* -- close the PS / SVG page -- */
-void close_page(void)
+static void close_page1(void)
 {
 	if (!in_page)
 		return;
@@ -333,6 +353,14 @@ void close_page(void)
 	use_buffer = 0;
 }
 
+void close_page(void)
+{
+	if (rc_st == RC_REC)
+		rc_call('c', 0);
+	else
+		close_page1();
+}
+
 /* -- output a header/footer element -- */
 static void format_hf(char *d, char *p)
 {
@@ -424,17 +452,28 @@ static void format_hf(char *d, char *p)
 	*d = '\0';		/* in case of empty string */
 }
 
+/* -- output a header or footer string built at the end of the output buffer -- */
+static void hf_out(int off)
+{
+	a2b("\n");
+	if (svg)
+		svg_write(outbuf + off, mbf - outbuf - off);
+	else
+		fputs(outbuf + off, fout);
+	mbf = outbuf + off;
+	*mbf = '\0';
+}
+
 /* -- output the header or footer -- */
 static float headfooter(int header,
 			float pwidth,
 			float pheight)
 {
 	char tmp[2048], str[TEX_BUF_SZ + 512];
-	char *p, *q, *r, *outbuf_sav, *mbf_sav;
+	char *p, *q, *r;
 	float size, y, wsize;
 	struct FONTSPEC *f, f_sav;
-
-	int cft_sav, dft_sav, outbufsz_sav;
+	int cft_sav, dft_sav, mbf_off;
 
 	if (header) {
 		p = cfmt.header;
@@ -467,11 +506,9 @@ static float headfooter(int header,
 		wsize += size;
 		*r = '\0';
 	}
-	mbf_sav = mbf;
-	outbuf_sav = outbuf;
-	outbufsz_sav = outbufsz;
-	outbuf = tmp;
-	outbufsz = sizeof tmp;
+
+	/* the strings are built at the end of the output buffer */
+	mbf_off = mbf - outbuf;
 	for (;;) {
 		tex_str(p);
 		strcpy(tmp, tex_buf);
@@ -484,13 +521,8 @@ static float headfooter(int header,
 				*q = '\0';
 				output(fout, "%.1f %.1f M ",
 					p_fmt->leftmargin, y);
-				mbf = tmp;
 				str_out(p, A_LEFT);
-				a2b("\n");
-				if (svg)
-					svg_write(tmp, strlen(tmp));
-				else
-					fputs(tmp, fout);
+				hf_out(mbf_off);
 			}
 			p = q + 1;
 		}
@@ -501,13 +533,8 @@ static float headfooter(int header,
 		if (q != p) {
 			output(fout, "%.1f %.1f M ",
 				pwidth * 0.5, y);
-			mbf = tmp;
 			str_out(p, A_CENTER);
-			a2b("\n");
-			if (svg)
-				svg_write(tmp, strlen(tmp));
-			else
-				fputs(tmp, fout);
+			hf_out(mbf_off);
 		}
 
 		/* right side */
@@ -516,13 +543,8 @@ static float headfooter(int header,
 			if (*p != '\0') {
 				output(fout, "%.1f %.1f M ",
 					pwidth - p_fmt->rightmargin, y);
-				mbf = tmp;
 				str_out(p, A_RIGHT);
-				a2b("\n");
-				if (svg)
-					svg_write(tmp, strlen(tmp));
-				else
-					fputs(tmp, fout);
+				hf_out(mbf_off);
 			}
 		}
 		if (!r)
@@ -533,10 +555,7 @@ static float headfooter(int header,
 		y -= size;
 	}
 
-	/* restore the buffer and fonts */
-	outbuf = outbuf_sav;
-	outbufsz = outbufsz_sav;
-	mbf = mbf_sav;
+	/* restore the fonts */
 	memcpy(&cfmt.font_tb[0], &f_sav, sizeof cfmt.font_tb[0]);
 	set_str_font(cft_sav, dft_sav);
 	return wsize;
@@ -736,26 +755,151 @@ void write_eps(void)
 	cur_scale = 1.0;
 }
 
+/* -- account for a tune generated by an other job -- */
+void skip_eps(void)
+{
+	nepsf++;
+}
+
 /*  subroutines to handle output buffer  */
 
+/* -- check if there is enough room in the output buffer, grow it if not -- */
+static void b_check(int len)
+{
+	char *p;
+
+	if (mbf + len + BSIZE <= outbuf + outbufsz)
+		return;
+	outbufsz = outbufsz * 2 + len;
+	p = realloc(outbuf, outbufsz);
+	if (!p) {
+		error(1, NULL, "Out of memory for outbuf - abort");
+		exit(EXIT_FAILURE);
+	}
+	mbf = p + (mbf - outbuf);
+	outbuf = p;
+}
+
 /* -- update the output buffer pointer -- */
 void a2b(char *fmt, ...)
 {
 	va_list args;
+	int l;
+#ifndef PRINTF_FMT
+	char *p;
 
-	if (mbf + BSIZE > outbuf + outbufsz) {
-		if (epsf) {
-			error(1, NULL, "Output buffer overflow - increase outbufsz");
-			fprintf(stderr, "*** abort\n");
-			exit(EXIT_FAILURE);
+	/* fast paths: no conversion, "%s" or "%.*s" */
+	for (p = fmt; *p != '%'; p++) {
+		if (*p == '\0') {
+			b_put(fmt, p - fmt);
+			return;
+		}
+	}
+	if (p == fmt) {
+		if (p[1] == 's' && p[2] == '\0') {
+			va_start(args, fmt);
+			p = va_arg(args, char *);
+			va_end(args);
+			b_put(p, strlen(p));
+			return;
+		}
+		if (strcmp(p, "%.*s") == 0) {
+			va_start(args, fmt);
+			l = va_arg(args, int);
+			p = va_arg(args, char *);
+			va_end(args);
+			b_put(p, strnlen(p, l));
+			return;
 		}
-		error(0, NULL, "Possible buffer overflow");
-		write_buffer();
-//		use_buffer = 0;
 	}
+#endif
+
+	b_check(0);
 	va_start(args, fmt);
-	mbf += vsnprintf(mbf, outbuf + outbufsz - mbf, fmt, args);
+	l = vsnprintf(mbf, outbuf + outbufsz - mbf, fmt, args);
 	va_end(args);
+	if (mbf + l >= outbuf + outbufsz) {	/* truncated */
+		b_check(l);
+		va_start(args, fmt);
+		vsnprintf(mbf, outbuf + outbufsz - mbf, fmt, args);
+		va_end(args);
+	}
+	mbf += l;
+}
+
+/* -- put raw data in the output buffer -- */
+void b_put(char *p, int len)
+{
+	b_check(len);
+	memcpy(mbf, p, len);
+	mbf += len;
+	*mbf = '\0';
+}
+
+/* -- format a float with 'nd' (1 or 2) decimals as "%.1f" or "%.2f" -- */
+/* (PRINTF_FMT forces printf and a2b() conversions - see 'make check-fmt') */
+#ifdef PRINTF_FMT
+static char *ftoa(char *p, float v, int nd)
+{
+	return p + sprintf(p, nd == 1 ? "%.1f" : "%.2f", v);
+}
+#else
+static char *ftoa(char *p, float v, int nd)
+{
+	double t;
+	unsigned long long n;
+	char buf[24], *q;
+	int i;
+
+	t = v * (nd == 1 ? 10. : 100.);		/* (exact in double) */
+	if (!(t > -1e15 && t < 1e15))		/* NaN, infinite or too big */
+		return p + sprintf(p, nd == 1 ? "%.1f" : "%.2f", v);
+	t = rint(t);				/* round as printf */
+	if (signbit(t)) {
+		*p++ = '-';
+		t = -t;
+	}
+	n = t;
+	q = &buf[sizeof buf];
+	for (i = 0; i < nd; i++) {
+		*--q = '0' + n % 10;
+		n /= 10;
+	}
+	*--q = '.';
+	do {
+		*--q = '0' + n % 10;
+		n /= 10;
+	} while (n != 0);
+	i = &buf[sizeof buf] - q;
+	memcpy(p, q, i);
+	return p + i;
+}
+#endif
+
+/* -- output a float and a space as "%.1f " -- */
+void emit_f(float v)
+{
+	b_check(0);
+	mbf = ftoa(mbf, v, 1);
+	*mbf++ = ' ';
+	*mbf = '\0';
+}
+
+/* -- output a couple of floats as "%.1f %.1f " -- */
+void emit_xy(float x, float y)
+{
+	b_check(0);
+	mbf = ftoa(mbf, x, 1);
+	*mbf++ = ' ';
+	mbf = ftoa(mbf, y, 1);
+	*mbf++ = ' ';
+	*mbf = '\0';
+}
+
+/* -- output a string (operator) -- */
+void emit_op(char *op)
+{
+	b_put(op, strlen(op));
 }
 
 /* -- translate down by 'h' scaled points in output buffer -- */
@@ -764,7 +908,11 @@ void bskip(float h)
 	if (h == 0)
 		return;
 	bposy -= h * cfmt.scale;
-	a2b("0 %.2f T\n", -h);
+	b_check(0);
+	*mbf++ = '0';
+	*mbf++ = ' ';
+	mbf = ftoa(mbf, -h, 2);
+	b_put(" T\n", 3);
 }
 
 /* -- initialize the output buffer -- */
@@ -786,15 +934,16 @@ void init_outbuf(int kbsz)
 }
 
 /* -- write buffer contents, break at full pages -- */
-void write_buffer(void)
+static void write_buffer1(void)
 {
 	char *p_buf;
-	int l, np;
+	int l, np, off;
 	float p1, dp;
 	int outft_sav;
 
 	if (mbf == outbuf || multicol_start != 0)
 		return;
+	prof_begin(PROF_WRITE);
 	if (!in_page && !epsf)
 		init_page();
 	outft_sav = outft;
@@ -817,8 +966,10 @@ void write_buffer(void)
 		dp = ln_pos[l] - p1;
 		np = remy + dp < 0 && !epsf;
 		if (np) {
+			off = p_buf - outbuf;
 			close_page();
 			init_page();
+			p_buf = outbuf + off;	/* (the buffer may have moved) */
 			if (ln_font[l] >= 0) {
 				struct FONTSPEC *f;
 
@@ -843,9 +994,9 @@ void write_buffer(void)
 		}
 		if (*p_buf != '\001') {
 			if (epsf > 1 || svg)
-				svg_write(p_buf, ln_buf[l] - p_buf);
+				svg_write(p_buf, outbuf + ln_buf[l] - p_buf);
 			else
-				fwrite(p_buf, 1, ln_buf[l] - p_buf, fout);
+				fwrite(p_buf, 1, outbuf + ln_buf[l] - p_buf, fout);
 		} else {			/* %%EPS - see parse.c */
 			FILE *f;
 			char line[BSIZE], *p, *q;
@@ -888,7 +1039,7 @@ void write_buffer(void)
 				fclose(f);
 			}
 		}
-		p_buf = ln_buf[l];
+		p_buf = outbuf + ln_buf[l];
 		remy += dp;
 		p1 = ln_pos[l];
 	}
@@ -906,10 +1057,19 @@ void write_buffer(void)
 	ln_num = 0;
 	if (epsf != 3)
 		use_buffer = 0;
+	prof_end(PROF_WRITE);
+}
+
+void write_buffer(void)
+{
+	if (rc_st == RC_REC)
+		rc_call('w', 0);
+	else
+		write_buffer1();
 }
 
 /* -- add a block of commmon margins / scale in the output buffer -- */
-void block_put(void)
+static void block_put1(void)
 {
 	if (mbf == outbuf)
 		return;
@@ -917,24 +1077,21 @@ void block_put(void)
 	if (remy == 0)
 		remy = maxy = (cfmt.landscape ? cfmt.pagewidth : cfmt.pageheight)
 			- cfmt.topmargin - cfmt.botmargin;
-	if (ln_num > 0 && mbf == ln_buf[ln_num - 1])
+	if (ln_num > 0 && mbf == outbuf + ln_buf[ln_num - 1])
 		return;				/* no data */
-	if (ln_num >= BUFFLN) {
-		char c, *p;
-
-		error(1, NULL, "max number of buffer lines exceeded"
-				" -- check BUFFLN");
-		multicol_start = 0;
-		p = ln_buf[ln_num - 1];
-		c = *p;				/* (avoid "buffer not empty") */
-		*p = '\0';
-		write_buffer();
-		multicol_start = remy + bposy;
-		*p = c;
-		strcpy(outbuf, p);
-//		use_buffer = 0;
+	if (ln_num >= ln_max) {
+		ln_max = ln_max ? ln_max * 2 : BUFFLN;
+		ln_pos = realloc(ln_pos, ln_max * sizeof *ln_pos);
+		ln_buf = realloc(ln_buf, ln_max * sizeof *ln_buf);
+		ln_lmarg = realloc(ln_lmarg, ln_max * sizeof *ln_lmarg);
+		ln_scale = realloc(ln_scale, ln_max * sizeof *ln_scale);
+		ln_font = realloc(ln_font, ln_max * sizeof *ln_font);
+		if (!ln_pos || !ln_buf || !ln_lmarg || !ln_scale || !ln_font) {
+			error(1, NULL, "Out of memory for buffer lines - abort");
+			exit(EXIT_FAILURE);
+		}
 	}
-	ln_buf[ln_num] = mbf;
+	ln_buf[ln_num] = mbf - outbuf;
 	ln_pos[ln_num] = multicol_start == 0 ? bposy : 1;
 	ln_lmarg[ln_num] = cfmt.leftmargin;
 	if (epsf) {
@@ -951,10 +1108,18 @@ void block_put(void)
 		write_buffer();
 }
 
+void block_put(void)
+{
+	if (rc_st == RC_REC)
+		rc_call('b', 0);
+	else
+		block_put1();
+}
+
 /* -- handle completed block in buffer -- */
 /* if the added stuff does not fit on current page, write it out
    after page break and change buffer handling mode to pass though */
-void buffer_eob(int eot)
+static void buffer_eob1(int eot)
 {
 	block_put();
 	if (epsf) {
@@ -1008,19 +1173,494 @@ void buffer_eob(int eot)
 #endif
 }
 
-/* -- dump buffer if not enough place for a music line -- */
-void check_buffer(void)
+void buffer_eob(int eot)
 {
-	if (mbf + 5000 > outbuf + outbufsz) { /* assume music line < 5000 bytes */
-		error(0, NULL,
-		      "Possibly bad page breaks, outbufsz exceeded");
-		write_buffer();
-//		use_buffer = 0;
-	}
+	if (rc_st == RC_REC)
+		rc_call('e', eot);
+	else
+		buffer_eob1(eot);
 }
 
 /* -- return the current vertical offset in the page -- */
 float get_bposy(void)
 {
+	rc_st = RC_NONE;		/* depends on the page: don't cache */
 	return remy + bposy;
 }
+
+/* -- render cache -- */
+/* With --cache=dir, the output of the tunes is saved in the directory
+ * 'dir'. The file name is a hash of the tune source (from X: to the
+ * end of tune), of the global source lines, of the current format and
+ * of the output mode.
+ * When a tune is found in the cache, the generation is skipped and
+ * the saved output is put in the output buffer by replaying the buffer
+ * calls (block_put, buffer_eob, write_buffer and close_page), so that
+ * the page breaks are done as if the tune had been generated.
+ * The tunes which depend on the page position, which change the global
+ * state (fonts, pages, PS/SVG definitions..), which have errors
+ * or which are preceded by global definitions (these ones are treated
+ * with the tune) are not cached.
+ * When the cache is bigger than its max size, the least recently
+ * used files are removed. */
+
+#define RC_H0 14695981039346656037ULL	/* FNV-1a */
+#define RC_MAGIC "abcmrc1\n"
+
+struct rc_ev {			/* recorded buffer call */
+	char type;			/* 'b', 'e', 'w', 'c' or 'z' (end) */
+	char eot;			/* buffer_eob() argument */
+	char use_buffer;
+	signed char outft;
+	int len;			/* length of the output before the call */
+	float bposy, lmarg, rmarg, scale, multicol;
+};
+struct rc_hdr {			/* cache file header */
+	char magic[8];
+	int size;			/* file size */
+	int tunes;			/* tunenum increment */
+	char fonts[MAXFONTS];		/* fonts to mark as used */
+};
+
+static unsigned long long rc_gh, rc_th; /* global and tune source hashes */
+static int rc_intune;		/* tune source being hashed */
+static int rc_unsafe;		/* the tune cannot be cached */
+static char *rc_buf;		/* recorded output */
+static int rc_len, rc_sz;
+static int rc_mark;		/* start of the unrecorded output in outbuf */
+static int rc_tunenum, rc_nfonts;
+static char rc_fonts[MAXFONTS];
+static char rc_fn[FILENAME_MAX];
+static long rc_total = -1;	/* size of the cache (-1: unknown) */
+
+/* pseudo-comments which prevent caching */
+static const char *rc_unsafe_tb[] = {
+	"newpage", "multicol", "beginps", "beginsvg", "postscript",
+	"glyph", "font", "setfont", "deco", "EPS",
+	"header", "footer", "pageheight", "pagewidth",
+	"topmargin", "botmargin", "landscape", "topspace",
+	"splittune", "oneperpage",
+	NULL
+};
+
+static unsigned long long rc_hash(unsigned long long h,
+				const void *p, int len)
+{
+	const unsigned char *q = p;
+
+	while (--len >= 0)
+		h = (h ^ *q++) * 1099511628211ULL;
+	return h;
+}
+
+static unsigned long long rc_hstr(unsigned long long h, const char *p)
+{
+	if (!p)
+		p = "";
+	return rc_hash(h, p, strlen(p) + 1);
+}
+
+/* -- hash a source line (called by abc_parse) -- */
+/* 'r' is the parse_line() result: 1: end of tune, 2: X: */
+void rcache_line(char *p, int r)
+{
+	const char **t;
+
+	switch (r) {
+	case 1:
+		rc_intune = 0;
+		return;
+	case 2:
+		rc_intune = 1;
+		rc_unsafe = 0;
+		rc_th = RC_H0;
+		break;
+	default:
+		if (!rc_intune) {
+			rc_gh = rc_hstr(rc_gh, p);
+			return;
+		}
+		break;
+	}
+	rc_th = rc_hstr(rc_th, p);
+	if (p[0] != '%' || p[1] != '%')
+		return;
+	p += 2;
+	while (isspace((unsigned char) *p))
+		p++;
+	for (t = rc_unsafe_tb; *t; t++) {
+		if (strncmp(p, *t, strlen(*t)) == 0) {
+			rc_unsafe = 1;
+			break;
+		}
+	}
+}
+
+/* -- check if a header/footer uses the tune information -- */
+static int rc_hf_info(char *p)
+{
+	if (!p)
+		return 0;
+	while ((p = strchr(p, '$')) != NULL) {
+		p++;
+		if (*p == 'T' || *p == 'I')
+			return 1;
+	}
+	return 0;
+}
+
+/* -- compute the hash of the current tune -- */
+static unsigned long long rc_key(void)
+{
+	struct FORMAT f;
+	unsigned long long h;
+	int i, mode[7];
+
+	h = rc_hstr(RC_H0, VERSION);
+	h = rc_hash(h, &rc_gh, sizeof rc_gh);
+	h = rc_hash(h, &rc_th, sizeof rc_th);
+
+	memcpy(&f, &cfmt, sizeof f);
+	f.bgcolor = f.dateformat = f.header = f.footer = NULL;
+	f.titleformat = f.musicfont = NULL;
+	h = rc_hash(h, &f, sizeof f);
+	h = rc_hstr(h, cfmt.bgcolor);
+	h = rc_hstr(h, cfmt.dateformat);
+	h = rc_hstr(h, cfmt.header);
+	h = rc_hstr(h, cfmt.footer);
+	h = rc_hstr(h, cfmt.titleformat);
+	h = rc_hstr(h, cfmt.musicfont);
+	for (i = 0; i < nfontnames; i++)
+		h = rc_hstr(h, fontnames[i]);
+
+	mode[0] = svg;
+	mode[1] = pagenumbers;
+	mode[2] = showerror;
+	mode[3] = pipeformat;
+	mode[4] = secure;
+	mode[5] = file_initialized > 0;
+	mode[6] = shared_defs;
+	return rc_hash(h, mode, sizeof mode);
+}
+
+/* -- execute a buffer call -- */
+static void rc_do(int type, int eot)
+{
+	switch (type) {
+	case 'b':
+		block_put1();
+		break;
+	case 'e':
+		buffer_eob1(eot);
+		break;
+	case 'w':
+		write_buffer1();
+		break;
+	case 'c':
+		close_page1();
+		break;
+	}
+}
+
+/* -- record a buffer call with the output generated before it -- */
+static void rc_record(int type, int eot)
+{
+	struct rc_ev ev;
+	int l;
+
+	l = mbf - outbuf - rc_mark;
+	if (l < 0) {
+		rc_st = RC_NONE;
+		return;
+	}
+	if (rc_len + (int) sizeof ev + l > rc_sz) {
+		rc_sz = (rc_len + sizeof ev + l) * 2;
+		rc_buf = realloc(rc_buf, rc_sz);
+		if (!rc_buf) {
+			error(1, NULL, "Out of memory for the render cache - abort");
+			exit(EXIT_FAILURE);
+		}
+	}
+	ev.type = type;
+	ev.eot = eot;
+	ev.use_buffer = use_buffer;
+	ev.outft = outft;
+	ev.len = l;
+	ev.bposy = bposy;
+	ev.lmarg = cfmt.leftmargin;
+	ev.rmarg = cfmt.rightmargin;
+	ev.scale = cfmt.scale;
+	ev.multicol = multicol_start;
+	memcpy(rc_buf + rc_len, &ev, sizeof ev);
+	rc_len += sizeof ev;
+	memcpy(rc_buf + rc_len, outbuf + rc_mark, l);
+	rc_len += l;
+}
+
+/* -- buffer call while recording -- */
+static void rc_call(int type, int eot)
+{
+	if (rc_depth == 0)
+		rc_record(type, eot);
+	rc_depth++;
+	rc_do(type, eot);
+	if (--rc_depth == 0)
+		rc_mark = mbf - outbuf;
+}
+
+/* -- put a cached tune in the output buffer -- */
+static int rc_replay(void)
+{
+	FILE *f;
+	struct rc_hdr hd;
+	struct rc_ev ev;
+	char *buf, *p;
+	float lmarg, rmarg, scale;
+	int i, l;
+
+	f = fopen(rc_fn, "rb");
+	if (!f)
+		return 0;
+	if (fread(&hd, 1, sizeof hd, f) != sizeof hd
+	 || memcmp(hd.magic, RC_MAGIC, sizeof hd.magic) != 0
+	 || hd.size <= (int) (sizeof hd + sizeof ev)) {
+		fclose(f);
+		return 0;
+	}
+	l = hd.size - sizeof hd;
+	buf = malloc(l);
+	if (!buf || fread(buf, 1, l, f) != (size_t) l) {
+		free(buf);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+
+	/* check the calls */
+	for (p = buf; ; ) {
+		if (p + sizeof ev > buf + l)
+			goto bad;
+		memcpy(&ev, p, sizeof ev);
+		p += sizeof ev;
+		if (ev.len < 0 || p + ev.len > buf + l)
+			goto bad;
+		p += ev.len;
+		if (ev.type == 'z')
+			break;
+	}
+
+	for (i = 0; i < MAXFONTS; i++) {
+		if (hd.fonts[i])
+			used_font[i] = 1;
+	}
+	lmarg = cfmt.leftmargin;
+	rmarg = cfmt.rightmargin;
+	scale = cfmt.scale;
+	for (p = buf; ; ) {
+		memcpy(&ev, p, sizeof ev);
+		p += sizeof ev;
+		if (ev.len > 0)
+			b_put(p, ev.len);
+		p += ev.len;
+		bposy = ev.bposy;
+		cfmt.leftmargin = ev.lmarg;
+		cfmt.rightmargin = ev.rmarg;
+		cfmt.scale = ev.scale;
+		multicol_start = ev.multicol;
+		use_buffer = ev.use_buffer;
+		outft = ev.outft;
+		if (ev.type == 'z')
+			break;
+		rc_do(ev.type, ev.eot);
+	}
+	cfmt.leftmargin = lmarg;
+	cfmt.rightmargin = rmarg;
+	cfmt.scale = scale;
+	tunenum += hd.tunes;
+	free(buf);
+	utime(rc_fn, NULL);		/* LRU */
+	return 1;
+bad:
+	free(buf);
+	return 0;
+}
+
+struct rc_file {			/* cache file (for cleaning) */
+	time_t t;
+	long sz;
+	char *fn;
+};
+
+static int rc_cmp(const void *a, const void *b)
+{
+	const struct rc_file *fa = a, *fb = b;
+
+	if (fa->t != fb->t)
+		return fa->t < fb->t ? -1 : 1;
+	return 0;
+}
+
+/* -- compute the size of the cache and remove the oldest files -- */
+static void rc_clean(void)
+{
+	DIR *d;
+	struct dirent *e;
+	struct stat sbuf;
+	struct rc_file *tb, *tb2;
+	char *fn;
+	int i, n, nmax, l;
+
+	d = opendir(rcache_dir);
+	if (!d)
+		return;
+	tb = NULL;
+	n = nmax = 0;
+	rc_total = 0;
+	while ((e = readdir(d)) != NULL) {
+		l = strlen(e->d_name);
+		if (l != 16 + 3 || strcmp(e->d_name + 16, ".rc") != 0)
+			continue;
+		fn = malloc(strlen(rcache_dir) + l + 2);
+		sprintf(fn, "%s%c%s", rcache_dir, DIRSEP, e->d_name);
+		if (stat(fn, &sbuf) != 0) {
+			free(fn);
+			continue;
+		}
+		if (n >= nmax) {
+			nmax = nmax ? nmax * 2 : 256;
+			tb2 = realloc(tb, nmax * sizeof *tb);
+			if (!tb2) {
+				free(fn);
+				break;
+			}
+			tb = tb2;
+		}
+		tb[n].t = sbuf.st_mtime;
+		tb[n].sz = sbuf.st_size;
+		tb[n].fn = fn;
+		rc_total += sbuf.st_size;
+		n++;
+	}
+	closedir(d);
+	if (rc_total > rcache_max) {		/* remove the oldest files */
+		qsort(tb, n, sizeof *tb, rc_cmp);
+		for (i = 0; i < n && rc_total > rcache_max / 4 * 3; i++) {
+			if (remove(tb[i].fn) != 0)
+				continue;
+			rc_total -= tb[i].sz;
+			rcache_evict++;
+		}
+	}
+	for (i = 0; i < n; i++)
+		free(tb[i].fn);
+	free(tb);
+}
+
+/* -- save the recorded tune -- */
+static void rc_save(void)
+{
+	FILE *f;
+	struct rc_hdr hd;
+	char tmp[FILENAME_MAX + 16];
+	int i;
+
+	if (rc_len > rcache_max / 8)		/* too big */
+		return;
+	memcpy(hd.magic, RC_MAGIC, sizeof hd.magic);
+	hd.size = rc_len;
+	hd.tunes = tunenum - rc_tunenum;
+	for (i = 0; i < MAXFONTS; i++)
+		hd.fonts[i] = used_font[i] && !rc_fonts[i];
+	memcpy(rc_buf, &hd, sizeof hd);
+
+	/* write in a temporary file, so that concurrent jobs
+	 * never see a partial file */
+#if defined(unix) || defined(__unix__)
+	snprintf(tmp, sizeof tmp, "%s.%ld", rc_fn, (long) getpid());
+#else
+	snprintf(tmp, sizeof tmp, "%s.tmp", rc_fn);
+#endif
+	f = fopen(tmp, "wb");
+	if (!f && errno == ENOENT) {
+#ifdef WIN32
+		mkdir(rcache_dir);
+#else
+		mkdir(rcache_dir, 0755);
+#endif
+		f = fopen(tmp, "wb");
+	}
+	if (!f)
+		return;
+	i = fwrite(rc_buf, 1, rc_len, f) == (size_t) rc_len;
+	if (fclose(f) != 0 || !i || rename(tmp, rc_fn) != 0) {
+		remove(tmp);
+		return;
+	}
+	rcache_store++;
+	if (rc_total < 0)
+		rc_clean();
+	else
+		rc_total += rc_len;
+	if (rc_total > rcache_max)
+		rc_clean();
+}
+
+/* -- start of tune generation -- */
+/* return 1 if the tune has been found in the cache */
+int rcache_start(void)
+{
+	if (!rc_intune)
+		return 0;
+	rc_intune = 0;
+	if (rc_unsafe || epsf || annotate
+	 || multicol_start != 0
+	 || !parse.first_sym			/* global definitions */
+	 || parse.first_sym->abc_type != ABC_T_INFO	/* before X: */
+	 || parse.first_sym->text[0] != 'X'
+	 || rc_hf_info(cfmt.header) || rc_hf_info(cfmt.footer))
+		return 0;
+	snprintf(rc_fn, sizeof rc_fn, "%s%c%016llx.rc",
+		rcache_dir, DIRSEP, rc_key());
+	if (rc_replay()) {
+		rcache_hit++;
+		return 1;
+	}
+	rcache_miss++;
+	if (rc_sz < (int) sizeof(struct rc_hdr)) {
+		char *p;
+
+		p = realloc(rc_buf, 0x10000);
+		if (!p)
+			return 0;		/* (not cached) */
+		rc_buf = p;
+		rc_sz = 0x10000;
+	}
+	rc_st = RC_REC;
+	rc_depth = 0;
+	rc_mark = mbf - outbuf;
+	rc_len = sizeof(struct rc_hdr);
+	rc_tunenum = tunenum;
+	rc_nfonts = nfontnames;
+	memcpy(rc_fonts, used_font, sizeof rc_fonts);
+	return 0;
+}
+
+/* -- end of tune generation -- */
+void rcache_end(void)
+{
+	if (rc_st != RC_REC)
+		return;
+	rc_record('z', 0);
+	if (rc_st != RC_REC)
+		return;
+	rc_st = RC_NONE;
+	if (nfontnames != rc_nfonts)		/* new fonts */
+		return;
+	rc_save();
+}
+
+/* -- don't cache the current tune -- */
+void rcache_abort(void)
+{
+	rc_st = RC_NONE;
+}
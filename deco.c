@@ -21,15 +21,17 @@
 #endif
 
 #include "abcm2ps.h"
+#include "skyline.h"
 
 int defl;		/* decoration flags */
+int ystep = YSTEP;	/* number of steps for y offsets */
 char *deco[256];	/* decoration names */
 
 static struct deco_elt {
 	struct deco_elt *next, *prev;	/* next/previous decoration */
 	struct SYMBOL *s;	/* symbol */
 	struct deco_elt *start;	/* start a long decoration ending here */
-	unsigned char t;	/* decoration index */
+	unsigned short t;	/* decoration index */
 	unsigned char staff;	/* staff */
 	unsigned char flags;
 #define DE_VAL	0x01		/* put extra value if 1 */
@@ -51,6 +53,8 @@ typedef void draw_f(struct deco_elt *de);
 static draw_f d_arp, d_cresc, d_near, d_slide, d_upstaff,
 		d_pf, d_trill;
 
+#define NDECO 512		/* max number of decorations */
+
 /* decoration table */
 /* !! don't change the order of the numbered items !! */
 static struct deco_def_s {
@@ -60,10 +64,12 @@ static struct deco_def_s {
 	unsigned char h;	/* height */
 	unsigned char wl, wr;	/* left and right widths */
 	unsigned char strx;	/* string index - 255=deco name */
-	unsigned char ld_start;	/* index of start of long decoration */
-	unsigned char ld_end;	/* index of end of long decoration */
 	unsigned char flags;	/* only DE_LDST and DE_LDEN */
-} deco_def_tb[128];
+	unsigned short ld_start; /* index of start of long decoration */
+	unsigned short ld_end;	/* index of end of long decoration */
+} deco_def_tb[NDECO];
+static unsigned short deco_hash[NDECO * 2];	/* indexes by name */
+static int ndeco = 1;			/* number of decorations */
 
 /* c function table */
 static draw_f *func_tb[] = {
@@ -183,17 +189,36 @@ static char *std_deco_tb[] = {
 	0
 };
 
-/* user decorations */
+/* decoration definitions (standard and %%deco) by name */
+#define DDEF_HSZ 256		/* size of the hash table (power of 2) */
 static struct u_deco {
-	struct u_deco *next;
-	char text[256];			// dummy size
-} *user_deco;
+	struct u_deco *next;		/* hash link */
+	char *text;
+} *deco_def_htb[DDEF_HSZ];
 
 //static struct SYMBOL *first_note;	/* first note/rest of the line */
 
-static unsigned char deco_define(char *name);
+static unsigned short deco_define(char *name);
 static void draw_gchord(struct SYMBOL *s, float gchy_min, float gchy_max);
 
+/* -- set the number of steps of the y offsets from the staff width -- */
+void y_init(void)
+{
+	int staff, i;
+
+	ystep = realwidth / YSTEPW;
+	if (ystep < YSTEP)
+		ystep = YSTEP;
+	else if (ystep > YSTEPMAX)
+		ystep = YSTEPMAX;
+	for (staff = 0; staff <= nstaff; staff++) {
+		for (i = 0; i < ystep; i++) {
+			staff_tb[staff].top[i] = 0;
+			staff_tb[staff].bot[i] = 24;
+		}
+	}
+}
+
 /* -- get the max/min vertical offset -- */
 float y_get(int staff,
 		int up,
@@ -202,36 +227,23 @@ float y_get(int staff,
 {
 	struct STAFF_S *p_staff;
 	int i, j;
-	float y;
 
 	p_staff = &staff_tb[staff];
-	i = (int) (x / realwidth * YSTEP);
+	i = (int) (x / realwidth * ystep);
 	if (i < 0) {
 //		fprintf(stderr, "y_get i:%d\n", i);
 		i = 0;
 	}
-	j = (int) ((x + w) / realwidth * YSTEP);
-	if (j >= YSTEP) {
-		j = YSTEP - 1;
+	j = (int) ((x + w) / realwidth * ystep);
+	if (j >= ystep) {
+		j = ystep - 1;
 		if (i > j)
 			i = j;
 	}
-	if (up) {
-		y = p_staff->top[i++];
-		while (i <= j) {
-			if (y < p_staff->top[i])
-				y = p_staff->top[i];
-			i++;
-		}
-	} else {
-		y = p_staff->bot[i++];
-		while (i <= j) {
-			if (y > p_staff->bot[i])
-				y = p_staff->bot[i];
-			i++;
-		}
-	}
-	return y;
+	if (j < i)
+		j = i;
+	return y_range(up ? &p_staff->top[i] : &p_staff->bot[i],
+			j - i + 1, up);
 }
 
 /* -- adjust the vertical offsets -- */
@@ -242,34 +254,24 @@ void y_set(int staff,
 		float y)
 {
 	struct STAFF_S *p_staff;
+	float *p;
 	int i, j;
 
 	p_staff = &staff_tb[staff];
-	i = (int) (x / realwidth * YSTEP);
+	i = (int) (x / realwidth * ystep);
 	/* (may occur when annotation on 'y' at start of an empty staff) */
 	if (i < 0) {
 //		fprintf(stderr, "y_set i:%d\n", i);
 		i = 0;
 	}
-	j = (int) ((x + w) / realwidth * YSTEP);
-	if (j >= YSTEP) {
-		j = YSTEP - 1;
+	j = (int) ((x + w) / realwidth * ystep);
+	if (j >= ystep) {
+		j = ystep - 1;
 		if (i > j)
 			i = j;
 	}
-	if (up) {
-		while (i <= j) {
-			if (p_staff->top[i] < y)
-				p_staff->top[i] = y;
-			i++;
-		}
-	} else {
-		while (i <= j) {
-			if (p_staff->bot[i] > y)
-				p_staff->bot[i] = y;
-			i++;
-		}
-	}
+	p = up ? p_staff->top : p_staff->bot;
+	y_bound(p, i, j, y, up);
 }
 
 //// set the string of a decoration
@@ -770,6 +772,36 @@ static void d_upstaff(struct deco_elt *de)
 //	}
 }
 
+/* -- hash a decoration name -- */
+static unsigned deco_hname(char *name, int l)
+{
+	unsigned h;
+
+	h = 2166136261u;
+	while (--l >= 0)
+		h = (h ^ (unsigned char) *name++) * 16777619;
+	return h;
+}
+
+/* -- add a decoration definition -- */
+/* the last definitions of a name are found first */
+static void deco_def_add(char *text, struct u_deco *d, int last)
+{
+	struct u_deco **pd;
+	int l;
+
+	for (l = 0; text[l] != ' ' && text[l] != '\0'; l++)
+		;
+	pd = &deco_def_htb[deco_hname(text, l) & (DDEF_HSZ - 1)];
+	if (last) {
+		while (*pd)
+			pd = &(*pd)->next;
+	}
+	d->text = text;
+	d->next = *pd;
+	*pd = d;
+}
+
 /* -- add a decoration - from %%deco -- */
 /* syntax:
  *	%%deco <name> <c_func> <ps_func> <h> <wl> <wr> [<str>]
@@ -780,31 +812,69 @@ void deco_add(char *s)
 	int l;
 
 	l = strlen(s);
-	d = malloc(sizeof *user_deco - sizeof user_deco->text + l + 1);
-	strcpy(d->text, s);
-	d->next = user_deco;
-	user_deco = d;
+	d = malloc(sizeof *d + l + 1);
+	strcpy((char *) (d + 1), s);
+	deco_def_add((char *) (d + 1), d, 0);
 }
 
-static int get_deco(char *name)
+/* -- get the definition of a decoration -- */
+static char *deco_def_get(char *name)
 {
-	struct deco_def_s *dd;
+	struct u_deco *d;
+	int l;
+
+	l = strlen(name);
+	for (d = deco_def_htb[deco_hname(name, l) & (DDEF_HSZ - 1)];
+	     d;
+	     d = d->next) {
+		if (strncmp(d->text, name, l) == 0
+		 && d->text[l] == ' ')
+			return d->text;
+	}
+	return NULL;
+}
+
+/* -- search a decoration -- */
+/* return its index or 0, and set *ph to its slot in the hash table */
+static int deco_find(char *name, unsigned *ph)
+{
+	unsigned h;
 	int ideco;
 
-	for (ideco = 1, dd = &deco_def_tb[1]; ideco < 128; ideco++, dd++) {
-		if (!dd->name
-		 || strcmp(dd->name, name) == 0)
-			return ideco;
+	h = deco_hname(name, strlen(name));
+	for (;;) {
+		h &= NDECO * 2 - 1;
+		ideco = deco_hash[h];
+		if (ideco == 0
+		 || strcmp(deco_def_tb[ideco].name, name) == 0)
+			break;
+		h++;
 	}
-	error(1, NULL, "Too many decorations");
+	*ph = h;
 	return ideco;
 }
 
-static unsigned char deco_build(char *name, char *text)
+/* -- get the index of a decoration, the next free one if new -- */
+static int get_deco(char *name)
+{
+	unsigned h;
+	int ideco;
+
+	ideco = deco_find(name, &h);
+	if (ideco != 0)
+		return ideco;
+	if (ndeco >= NDECO) {
+		error(1, NULL, "Too many decorations");
+		return NDECO;
+	}
+	return ndeco;
+}
+
+static unsigned short deco_build(char *name, char *text)
 {
 	struct deco_def_s *dd;
 	int c_func, ideco, h, o, wl, wr, n;
-	unsigned l, ps_x, strx;
+	unsigned l, ps_x, strx, hs;
 	char name2[32];
 	char ps_func[16];
 
@@ -812,20 +882,20 @@ static unsigned char deco_build(char *name, char *text)
 	if (sscanf(text, "%15s %d %15s %d %d %d%n",
 			name2, &c_func, ps_func, &h, &wl, &wr, &n) != 6) {
 		error(1, NULL, "Invalid %%%%deco %s", text);
-		return 128;
+		return NDECO;
 	}
 	if ((unsigned) c_func > 10
 	 && (c_func < 32 || c_func > 41)) {
 		error(1, NULL, "%%%%deco: bad C function index (%s)", text);
-		return 128;
+		return NDECO;
 	}
 	if (h < 0 || wl < 0 || wr < 0) {
 		error(1, NULL, "%%%%deco: cannot have a negative value (%s)", text);
-		return 128;
+		return NDECO;
 	}
 	if (h > 50 || wl > 80 || wr > 80) {
 		error(1, NULL, "%%%%deco: abnormal h/wl/wr value (%s)", text);
-		return 128;
+		return NDECO;
 	}
 	text += n;
 	while (isspace((unsigned char) *text))
@@ -833,7 +903,7 @@ static unsigned char deco_build(char *name, char *text)
 
 	/* search the decoration */
 	ideco = get_deco(name);
-	if (ideco == 128)
+	if (ideco == NDECO)
 		return ideco;
 	dd = &deco_def_tb[ideco];
 
@@ -845,7 +915,7 @@ static unsigned char deco_build(char *name, char *text)
 	}
 	if (ps_x == sizeof ps_func_tb / sizeof ps_func_tb[0]) {
 		error(1, NULL, "Too many postscript functions");
-		return 128;
+		return NDECO;
 	}
 
 	/* have an index for the string */
@@ -874,13 +944,17 @@ static unsigned char deco_build(char *name, char *text)
 		}
 		if (strx == sizeof str_tb / sizeof str_tb[0]) {
 			error(1, NULL, "Too many decoration strings");
-			return 128;
+			return NDECO;
 		}
 	}
 
 	/* set the values */
-	if (!dd->name)
-		dd->name = name;	/* new decoration */
+	if (!dd->name) {		/* new decoration */
+		dd->name = name;
+		deco_find(name, &hs);
+		deco_hash[hs] = ideco;
+		ndeco++;
+	}
 	dd->func = strncmp(dd->name, "head-", 5) == 0 ? 9 : c_func;
 	if (!ps_func_tb[ps_x]) {
 		if (ps_func[0] == '-' && ps_func[1] == '\0')
@@ -901,8 +975,6 @@ static unsigned char deco_build(char *name, char *text)
 	l--;
 	if (name[l] == '('
 	 || (name[l] == ')' && !strchr(name, '('))) {
-		struct deco_def_s *ddo;
-
 		strcpy(name2, name);
 		if (name[l] == '(') {
 			dd->flags = DE_LDST;
@@ -911,23 +983,19 @@ static unsigned char deco_build(char *name, char *text)
 			dd->flags = DE_LDEN;
 			name2[l] = '(';
 		}
-		for (o = 1, ddo = &deco_def_tb[1]; o < 128; o++, ddo++) {
-			if (!ddo->name)
-				break;
-			if (strcmp(ddo->name, name2) == 0) {
-				if (name[l] == '(') {
-					ddo->ld_start = ideco;
-					dd->ld_end = o;
-				} else {
-					dd->ld_start = o;
-					ddo->ld_end = ideco;
-				}
-				break;
+		o = deco_find(name2, &hs);
+		if (o != 0) {
+			if (name[l] == '(') {
+				deco_def_tb[o].ld_start = ideco;
+				dd->ld_end = o;
+			} else {
+				dd->ld_start = o;
+				deco_def_tb[o].ld_end = ideco;
 			}
-		}
-		if (o >= 128 || !ddo->name)
+		} else {
 //fixme: memory leak...
 			deco_define(strdup(name2));
+		}
 	}
 	return ideco;
 }
@@ -980,33 +1048,22 @@ static void set_feathered_beam(struct SYMBOL *s1,
 }
 
 /* -- define a decoration -- */
-static unsigned char deco_define(char *name)
+static unsigned short deco_define(char *name)
 {
-	struct u_deco *d;
-	unsigned char ideco;
-	int l;
+	char *text;
 
-	l = strlen(name);
-	for (d = user_deco; d; d = d->next) {
-		if (strncmp(d->text, name, l) == 0
-		 && d->text[l] == ' ')
-			return deco_build(name, d->text);
-	}
-	for (ideco = 0; ; ideco++) {
-		if (!std_deco_tb[ideco])
-			break;
-		if (strncmp(std_deco_tb[ideco], name, l) == 0
-		 && std_deco_tb[ideco][l] == ' ')
-			return deco_build(name, std_deco_tb[ideco]);
-	}
-	return 128;
+	text = deco_def_get(name);
+	if (!text)
+		return NDECO;
+	return deco_build(name, text);
 }
 
 /* -- convert the external deco number to the internal one -- */
-static unsigned char deco_intern(unsigned char ideco,
+static unsigned short deco_intern(unsigned short ideco,
 				struct SYMBOL *s)
 {
 	char *name;
+	unsigned h;
 
 	if (ideco < 128) {
 		name = deco[ideco];
@@ -1017,15 +1074,10 @@ static unsigned char deco_intern(unsigned char ideco,
 	} else {
 		name = parse.deco_tb[ideco - 128];
 	}
-	for (ideco = 1; ideco < 128; ideco++) {
-		if (!deco_def_tb[ideco].name) {
-			ideco = deco_define(name);
-			break;
-		}
-		if (strcmp(deco_def_tb[ideco].name, name) == 0)
-			break;
-	}
-	if (ideco == 128) {
+	ideco = deco_find(name, &h);
+	if (ideco == 0)
+		ideco = deco_define(name);
+	if (ideco == NDECO) {
 		if (cfmt.decoerr)
 			error(1, s, "Decoration !%s! not defined", name);
 		ideco = 0;
@@ -1040,7 +1092,7 @@ void deco_cnv(struct decos *dc,
 {
 	int i, j, m, n;
 	struct deco_def_s *dd;
-	unsigned char ideco;
+	unsigned short ideco;
 	static char must_note_fmt[] = "Deco !%s! must be on a note";
 
 	for (i = dc->n; --i >= 0; ) {
@@ -1438,7 +1490,7 @@ static void deco_create(struct SYMBOL *s,
 			struct decos *dc)
 {
 	int k, m, posit;
-	unsigned char ideco;
+	unsigned short ideco;
 	struct deco_def_s *dd;
 	struct deco_elt *de;
 
@@ -1539,7 +1591,7 @@ static void ll_deco(void)
 			strcpy(name, dd->name);
 			name[l - 1] = ')';
 			t = get_deco(name);
-			if (t != 128) {
+			if (t != NDECO) {
 				struct deco_def_s *dd2;
 
 				dd2 = &deco_def_tb[t];
@@ -2445,8 +2497,8 @@ float draw_partempo(int staff, float top)
 				continue;
 
 			/*fixme: cf left shift (-5)*/
-			a2b("%.1f %.1f M ", s->x - 5,
-					(dosh & 1) ? h : y);
+			emit_xy(s->x - 5, (dosh & 1) ? h : y);
+			emit_op("M ");
 			dosh >>= 1;
 			write_tempo(g, beat, 1);
 		}
@@ -2492,7 +2544,8 @@ float draw_partempo(int staff, float top)
 		if (!g)
 			continue;
 //		w = tex_str(&g->text[2]);
-		a2b("%.1f %.1f M", s->x - 10, 2 - ht - h);
+		emit_xy(s->x - 10, 2 - ht - h);
+		emit_op("M");
 		tex_str(&g->text[2]);
 		str_out(tex_buf, A_LEFT);
 		if (cfmt.partsbox)
@@ -2510,8 +2563,17 @@ out:
 /* -- initialize the default decorations -- */
 void init_deco(void)
 {
+	struct u_deco *d;
+	int i;
+
 	memset(&deco, 0, sizeof deco);
 
+	/* put the standard definitions after the ones of %%deco */
+	for (i = 0; std_deco_tb[i]; i++) {
+		d = malloc(sizeof *d);
+		deco_def_add(std_deco_tb[i], d, 1);
+	}
+
 	/* standard */
 	deco['.'] = "dot";
 #ifdef DECO_IS_ROLL
@@ -2541,12 +2603,14 @@ void reset_deco(void)
 //	struct deco_def_s *dd;
 //	int ideco;
 //
-//	for (ideco = 1, dd = &deco_def_tb[1]; ideco < 128; ideco++, dd++) {
+//	for (ideco = 1, dd = &deco_def_tb[1]; ideco < ndeco; ideco++, dd++) {
 //		if (!dd->name)
 //			break;
 //		free(dd->name);
 //	}
-	memset(deco_def_tb, 0, sizeof deco_def_tb);
+	memset(deco_def_tb, 0, sizeof deco_def_tb[0] * ndeco);
+	memset(deco_hash, 0, sizeof deco_hash);
+	ndeco = 1;
 }
 
 /* -- set the decoration flags -- */
@@ -37,6 +37,8 @@ static void draw_note(float x,
 		      struct SYMBOL *s,
 		      int fl);
 static void set_tie_room(void);
+static void be_xy(float x, float y);
+static void be_sym(float x, float y, int op);
 
 // set the symbol color
 
@@ -984,7 +986,7 @@ static void draw_acc(int acc, int microscale)
 
 // draw helper lines
 static void draw_hl(float x, float staffb, int up,
-		int y, char *stafflines, char *hltype)
+		int y, char *stafflines, int hltype)
 {
 	int i, l;
 
@@ -997,19 +999,15 @@ static void draw_hl(float x, float staffb, int up,
 				break;
 		}
 		i = i * 6 - 6;
-		for ( ; i >= y; i -= 6) {
-			putxy(x, staffb + i);
-			a2b("%s ", hltype);
-		}
+		for ( ; i >= y; i -= 6)
+			be_sym(x, staffb + i, hltype);
 		return;
 	}
 
 	// upper ledger lines
 	i = l * 6;
-	for ( ; i <= y; i += 6) {
-		putxy(x, staffb + i);
-		a2b("%s ", hltype);
-	}
+	for ( ; i <= y; i += 6)
+		be_sym(x, staffb + i, hltype);
 }
 
 /* -- draw a key signature -- */
@@ -1134,11 +1132,11 @@ static void draw_keysig(struct VOICE_S *p_voice,
 			if (shift < 0)
 				draw_hl(x, staffb, 0,
 					shift,		/* lower ledger line */
-					staff_tb[s->staff].stafflines, "hl");
+					staff_tb[s->staff].stafflines, DOP_hl);
 			else if (shift > 24)
 				draw_hl(x, staffb, 1,
 					shift,		/* upper ledger line */
-					staff_tb[s->staff].stafflines, "hl");
+					staff_tb[s->staff].stafflines, DOP_hl);
 			last_shift = shift;
 			putxy(x, staffb + shift);
 			draw_acc(acc, s->u.key.microscale);
@@ -1189,9 +1187,8 @@ static int bar_cnv(int bar_type)
 /* -- draw a measure bar -- */
 static void draw_bar(struct SYMBOL *s, float bot, float h)
 {
-	int staff, bar_type;
+	int staff, bar_type, psf;
 	float x, yb;
-	char *psf;
 
 	staff = s->staff;
 	yb = staff_tb[staff].y;
@@ -1229,15 +1226,15 @@ static void draw_bar(struct SYMBOL *s, float bot, float h)
 	if (bar_type == 0)
 		return;				/* invisible */
 	for (;;) {
-		psf = "bar";
+		psf = DOP_bar;
 		switch (bar_type & 0x07) {
 		case B_BAR:
 			if (s->u.bar.dotted)
-				psf = "dotbar";
+				psf = DOP_dotbar;
 			break;
 		case B_OBRA:
 		case B_CBRA:
-			psf = "thbar";
+			psf = DOP_thbar;
 			x -= 3;
 			break;
 		case B_COL:
@@ -1247,7 +1244,7 @@ static void draw_bar(struct SYMBOL *s, float bot, float h)
 		switch (bar_type & 0x07) {
 		default:
 			set_sscale(-1);
-			a2b("%.1f %.1f %.1f %s ", h, x, bot, psf);
+			be->bar(h, x, bot, psf);
 			break;
 		case B_COL:
 			set_sscale(staff);
@@ -1271,11 +1268,6 @@ static void draw_rest(struct SYMBOL *s)
 //	int no_head;
 	char *stafflines;
 	float x, dotx, staffb;
-	static char *rest_tb[NFLAGS_SZ] = {
-		"r128", "r64", "r32", "r16", "r8",
-		"r4",
-		"r2", "r1", "r0", "r00"
-	};
 
 	/* don't display the rests of invisible staves */
 	/* (must do this here for voices out of their normal staff) */
@@ -1333,26 +1325,27 @@ static void draw_rest(struct SYMBOL *s)
 
 	y = s->y;
 
-	i = C_XFLAGS - s->nflags;		/* rest_tb index */
+	i = C_XFLAGS - s->nflags;		/* rest index (DOP_r128 + i) */
 	stafflines = staff_tb[s->staff].stafflines;
 	l = strlen(stafflines);
 	if (i == 7 && y == 12
 	 && l <= 2)
 		y -= 6;				/* semibreve a bit lower */
 
-	putxy(x, y + staffb);				/* rest */
-	a2b("%s ", s->u.note.notes[0].head ?
-			s->u.note.notes[0].head : rest_tb[i]);
+	if (s->u.note.notes[0].head) {			/* rest */
+		putxy(x, y + staffb);
+		a2b("%s ", s->u.note.notes[0].head);
+	} else {
+		be_sym(x, y + staffb, DOP_r128 + i);
+	}
 
 	/* output ledger line(s) when greater than minim */
 	if (i >= 6) {
 		j = y / 6;
 		switch (i) {
 		default:
-			if (j >= l - 1 || stafflines[j + 1] != '|') {
-				putxy(x, y + staffb);
-				a2b("hl1 ");
-			}
+			if (j >= l - 1 || stafflines[j + 1] != '|')
+				be_sym(x, y + staffb, DOP_hl1);
 			if (i == 9) {		// longa
 				y -= 6;
 				j--;
@@ -1364,15 +1357,14 @@ static void draw_rest(struct SYMBOL *s)
 		case 6:
 			break;
 		}
-		if (j >= l || stafflines[j] != '|') {
-			putxy(x, y + staffb);
-			a2b("hl1 ");
-		}
+		if (j >= l || stafflines[j] != '|')
+			be_sym(x, y + staffb, DOP_hl1);
 	}
 
 	dotx = 8;
 	for (i = 0; i < s->dots; i++) {
-		a2b("%.1f 3 dt ", dotx);
+		emit_f(dotx);
+		emit_op("3 dt ");
 		dotx += 3.5;
 	}
 	a2b("\n");
@@ -1579,7 +1571,7 @@ static void draw_basic_note(float x,
 			    signed char *y_tb)
 {
 	struct note *note = &s->u.note.notes[m];
-	int y, head, dots, nflags, acc;
+	int y, head, dots, nflags, acc, op;
 //	int no_head;
 	int old_color = -1;
 	float staffb, shhd;
@@ -1593,7 +1585,7 @@ static void draw_basic_note(float x,
 	if (s->flags & ABC_F_INVIS)
 		return;
 
-	putxy(x + shhd, y + staffb);		/* output x and y */
+	be_xy(x + shhd, y + staffb);		/* output x and y */
 
 //	/* special case when no head */
 //	if (s->nohdi1 >= 0
@@ -1622,13 +1614,12 @@ static void draw_basic_note(float x,
 			if (yy % 6)
 				yy += 3;
 		}
-		if (yy) {
-			putxy(x + shhd, yy + staffb);
-			a2b("hl ");
-		}
+		if (yy)
+			be_sym(x + shhd, yy + staffb, DOP_hl);
 	}
 
 	/* draw the head */
+	op = -1;
 	if (note->invisible) {
 		p = "xydef";
 	} else if ((p = note->head) != NULL) {
@@ -1636,7 +1627,7 @@ static void draw_basic_note(float x,
 		p = hd;
 		a2b("2 copy xydef ");		/* set x y */
 	} else if (s->flags & ABC_F_GRACE) {
-		p = "ghd";
+		op = DOP_ghd;
 	} else if (s->type == CUSTOS) {
 		p = "custos";
 	} else if ((s->sflags & S_PERC) && acc != 0) {
@@ -1647,16 +1638,16 @@ static void draw_basic_note(float x,
 		switch (head) {
 		case H_OVAL:
 			if (note->len < BREVE) {
-				p = "HD";
+				op = DOP_HD;
 				break;
 			}
 			if (s->head != H_SQUARE) {
-				p = "HDD";
+				op = DOP_HDD;
 				break;
 			}
 			/* fall thru */
 		case H_SQUARE:
-			p = note->len < BREVE * 2 ? "breve" : "longa";
+			op = note->len < BREVE * 2 ? DOP_breve : DOP_longa;
 
 			/* don't display dots on last note of the tune */
 			if (!tsnext && s->next
@@ -1664,16 +1655,19 @@ static void draw_basic_note(float x,
 				dots = 0;
 			break;
 		case H_EMPTY:
-			p = "Hd"; break;
+			op = DOP_Hd; break;
 		default:
-			p = "hd"; break;
+			op = DOP_hd; break;
 		}
 	}
 	if (note->color >= 0) {
 		old_color = cur_color;
 		set_color(note->color);
 	}
-	a2b("%s", p);
+	if (op >= 0)
+		be->op(op);
+	else
+		a2b("%s", p);
 
 	/* draw the dots */
 /*fixme: to see for grace notes*/
@@ -1686,7 +1680,7 @@ static void draw_basic_note(float x,
 		if (scale_voice)
 			doty /= cur_scale;
 		while (--dots >= 0) {
-			a2b(" %.1f %d dt", dotx, doty);
+			be->dot(dotx, doty);
 			dotx += 3.5;
 		}
 	}
@@ -1716,7 +1710,8 @@ static void draw_note(float x,
 {
 	int m, ma;
 	float staffb, slen, shhd;
-	char c, *hltype;
+	char c;
+	int hltype;
 	signed char y_tb[MAXHD];
 
 	if (s->dots)
@@ -1728,17 +1723,17 @@ static void draw_note(float x,
 	/* output the ledger lines */
 	if (!(s->flags & ABC_F_INVIS)) {
 		if (s->flags & ABC_F_GRACE) {
-			hltype = "ghl";
+			hltype = DOP_ghl;
 		} else {
 			switch (s->head) {
 			default:
-				hltype = "hl";
+				hltype = DOP_hl;
 				break;
 			case H_OVAL:
-				hltype = "hl1";
+				hltype = DOP_hl1;
 				break;
 			case H_SQUARE:
-				hltype = "hl2";
+				hltype = DOP_hl2;
 				break;
 			}
 		}
@@ -1775,7 +1770,10 @@ static void draw_note(float x,
 				else
 					slen += 1;
 			}
-			a2b(" %.1f %c%c", slen, c2, c);
+			if (c2 == 'g')
+				be->stem(slen, c == 'u' ? DOP_gu : DOP_gd);
+			else
+				be->stem(slen, c == 'u' ? DOP_su : DOP_sd);
 		} else {				/* stem and flags */
 			if (cfmt.straightflags)
 				c = 's';		/* straight flag */
@@ -1790,7 +1788,7 @@ static void draw_note(float x,
 		slen += staff_tb[s2->staff].y - staffb;
 /*fixme:KO when different scales*/
 		slen /= voice_tb[s->voice].scale;
-		a2b(" %.1f su", slen);
+		be->stem(slen, DOP_su);
 	}
 
 	/* draw the tremolo bars */
@@ -4102,13 +4100,7 @@ void draw_sym_near(void)
 		}
 	}
 
-	/* initialize the y offsets */
-	for (staff = 0; staff <= nstaff; staff++) {
-		for (i = 0; i < YSTEP; i++) {
-			staff_tb[staff].top[i] = 0;
-			staff_tb[staff].bot[i] = 24;
-		}
-	}
+	y_init();			/* initialize the y offsets */
 
 	set_tie_room();
 	draw_deco_near();
@@ -4299,7 +4291,8 @@ static void draw_vname(float indent)
 			q = strstr(p, "\\n");
 			if (q)
 				*q = '\0';
-			a2b("%.1f %.1f M ", indent, y);
+			emit_xy(indent, y);
+			emit_op("M ");
 			put_str(p, A_CENTER);
 			y -= 18.;
 			if (q)
@@ -4848,7 +4841,7 @@ void draw_all_symb(void)
 /* -- output a floating value, and x and y according to the current scale -- */
 void putf(float v)
 {
-	a2b("%.1f ", v);
+	emit_f(v);
 }
 
 void putx(float x)
@@ -4866,11 +4859,82 @@ void puty(float y)
 void putxy(float x, float y)
 {
 	if (scale_voice)
-		a2b("%.1f %.1f ",
-		     x / cur_scale, y / cur_scale);	/* scaled voice */
+		emit_xy(x / cur_scale, y / cur_scale);	/* scaled voice */
+	else
+		emit_xy(x / cur_scale, y - cur_trans);	/* scaled staff */
+}
+
+/* -- PostScript backend -- */
+char *dop_tb[NDOP] = {
+	"hd", "Hd", "HD", "HDD", "ghd",
+	"breve", "longa",
+	"r128", "r64", "r32", "r16", "r8",
+	"r4", "r2", "r1", "r0", "r00",
+	"hl", "hl1", "hl2", "ghl",
+	"su", "sd", "gu", "gd",
+	"dt",
+	"bar", "thbar", "dotbar",
+};
+
+static void ps_xy(float x, float y)
+{
+	emit_xy(x, y);
+}
+
+static void ps_op(int op)
+{
+	emit_op(dop_tb[op]);
+}
+
+static void ps_sym(float x, float y, int op)
+{
+	emit_xy(x, y);
+	emit_op(dop_tb[op]);
+	emit_op(" ");
+}
+
+static void ps_dot(float x, int y)
+{
+	emit_op(" ");
+	emit_f(x);
+	a2b("%d dt", y);
+}
+
+static void ps_stem(float h, int op)
+{
+	emit_op(" ");
+	emit_f(h);
+	emit_op(dop_tb[op]);
+}
+
+static void ps_bar(float h, float x, float y, int op)
+{
+	emit_f(h);
+	emit_xy(x, y);
+	emit_op(dop_tb[op]);
+	emit_op(" ");
+}
+
+struct backend ps_be = {
+	ps_xy, ps_op, ps_sym, ps_dot, ps_stem, ps_bar
+};
+struct backend *be = &ps_be;
+
+/* -- output x and y through the backend according to the current scale -- */
+static void be_xy(float x, float y)
+{
+	if (scale_voice)
+		be->xy(x / cur_scale, y / cur_scale);	/* scaled voice */
+	else
+		be->xy(x / cur_scale, y - cur_trans);	/* scaled staff */
+}
+
+static void be_sym(float x, float y, int op)
+{
+	if (scale_voice)
+		be->sym(x / cur_scale, y / cur_scale, op);
 	else
-		a2b("%.1f %.1f ",
-		     x / cur_scale, y - cur_trans);	/* scaled staff */
+		be->sym(x / cur_scale, y - cur_trans, op);
 }
 
 /* -- set the voice or staff scale -- */
@@ -23,9 +23,9 @@ struct FORMAT cfmt;		/* current format for output */
 char *fontnames[MAXFONTS];		/* list of font names */
 static char font_enc[MAXFONTS];		/* font encoding */
 static char def_font_enc[MAXFONTS];	/* default font encoding */
-static char used_font[MAXFONTS];	/* used fonts */
+char used_font[MAXFONTS];		/* used fonts */
 static float swfac_font[MAXFONTS];	/* width scale */
-static int nfontnames;
+int nfontnames;
 static float staffwidth;
 
 /* format table */
@@ -85,6 +85,7 @@ static struct format {
 	{"keywarn", &cfmt.keywarn, FORMAT_B, 0},
 	{"landscape", &cfmt.landscape, FORMAT_B, 0},
 	{"leftmargin", &cfmt.leftmargin, FORMAT_U, 1},
+	{"linebreakalgo", &cfmt.linebreakalgo, FORMAT_I, 6},
 	{"lineskipfac", &cfmt.lineskipfac, FORMAT_R, 0},
 	{"linewarn", &cfmt.linewarn, FORMAT_B, 0},
 	{"maxshrink", &cfmt.maxshrink, FORMAT_R, 2},
@@ -155,6 +156,47 @@ static struct format {
 	{0, 0, 0, 0}		/* end of table */
 };
 
+#define FMT_HSZ 256		/* size of the hash table (power of 2) */
+static unsigned char fmt_hash[FMT_HSZ];	/* format_tb indexes + 1 */
+
+/* -- get a format parameter from its name -- */
+static struct format *fmt_get(char *w)
+{
+	unsigned char *p;
+	unsigned h;
+	int i;
+
+	if (fmt_hash[0] == 0) {		/* build the hash table */
+		fmt_hash[0] = 1;	/* (slot 0 is never used) */
+		for (i = 0; format_tb[i].name; i++) {
+			h = 0;
+			for (p = (unsigned char *) format_tb[i].name; *p; p++)
+				h = h * 31 + *p;
+			for (;;) {
+				h &= FMT_HSZ - 1;
+				if (h != 0 && fmt_hash[h] == 0)
+					break;
+				h++;
+			}
+			fmt_hash[h] = i + 1;
+		}
+	}
+	h = 0;
+	for (p = (unsigned char *) w; *p; p++)
+		h = h * 31 + *p;
+	for (;;) {
+		h &= FMT_HSZ - 1;
+		if (h != 0) {
+			i = fmt_hash[h];
+			if (i == 0)
+				return NULL;
+			if (strcmp(format_tb[i - 1].name, w) == 0)
+				return &format_tb[i - 1];
+		}
+		h++;
+	}
+}
+
 static const char helvetica[] = "Helvetica";
 static const char times[] = "Times-Roman";
 static const char times_bold[] = "Times-Bold";
@@ -241,6 +283,8 @@ static void fontspec(struct FONTSPEC *f,
 	f->swfac = size;
 	if (swfac_font[f->fnum] != 0) {
 		f->swfac *= swfac_font[f->fnum];
+	} else if (fmetrics_have(f->fnum)) {
+		;				/* real widths */
 	} else if (strncmp(name, times, 5) == 0
 		|| strncmp(name, serif, 5) == 0) {
 		if (strcmp(name, times_bold) == 0
@@ -558,6 +602,10 @@ static char *yn[2] = {"no","yes"};
 					(cfmt.gracespace & 0xff) / 10,
 					(cfmt.gracespace & 0xff) % 10);
 				break;
+			case 6:			/* linebreakalgo */
+				printf("%s\n", cfmt.linebreakalgo ?
+						"optimal" : "greedy");
+				break;
 			}
 			break;
 		case FORMAT_R:
@@ -1086,6 +1134,26 @@ void interpret_fmt_line(char *w,		/* keyword */
 			}
 			return;
 		}
+		if (strcmp(w, "fontmetrics") == 0) {
+			int fnum;
+			char fname[80], fn[256];
+
+			p = get_str(fname, p, sizeof fname);
+			get_str(fn, p, sizeof fn);
+			if (fn[0] == '\0')
+				goto bad;
+			fnum = get_font(fname, -1);
+			if (fmetrics_load(fnum, fn) < 0)
+				return;
+			if (swfac_font[fnum] != 0)
+				return;
+			for (i = 0; i < FONT_MAX; i++) {
+				if (cfmt.font_tb[i].fnum == fnum)
+					cfmt.font_tb[i].swfac =
+							cfmt.font_tb[i].size;
+			}
+			return;
+		}
 		break;
 	case 'i':
 		if (strcmp(w, "infoname") == 0) {
@@ -1129,9 +1197,7 @@ void interpret_fmt_line(char *w,		/* keyword */
 			return;
 		}
 		if (strcmp(w, "scale") == 0) {
-			for (fd = format_tb; fd->name; fd++)
-				if (strcmp("pagescale", fd->name) == 0)
-					break;
+			fd = fmt_get("pagescale");
 			if (fd->lock)
 				return;
 			fd->lock = lock;
@@ -1167,10 +1233,8 @@ void interpret_fmt_line(char *w,		/* keyword */
 		}
 		break;
 	}
-	for (fd = format_tb; fd->name; fd++)
-		if (strcmp(w, fd->name) == 0)
-			break;
-	if (!fd->name)
+	fd = fmt_get(w);
+	if (!fd)
 		return;
 
 	i = strlen(p);
@@ -1271,6 +1335,14 @@ void interpret_fmt_line(char *w,		/* keyword */
 			cfmt.dblrepbar = get_dblrepbar(p);
 		else if (fd->subtype == 4 && !isdigit(*p)) /* textoption */
 			cfmt.textoption = get_textopt(p);
+		else if (fd->subtype == 6 && !isdigit(*p)) { /* linebreakalgo */
+			if (strcmp(p, "optimal") == 0)
+				cfmt.linebreakalgo = 1;
+			else if (strcmp(p, "greedy") == 0)
+				cfmt.linebreakalgo = 0;
+			else
+				goto bad;
+		}
 		else if (isdigit(*p) || *p == '-' || *p == '+')
 			sscanf(p, "%d", (int *) fd->v);
 		else
@@ -1418,7 +1490,8 @@ void set_font(int ft)
 		      fontnames[fnum]);
 		f->size = 8;
 	}
-	a2b("%.1f F%d ", f->size, fnum);
+	emit_f(f->size);
+	a2b("F%d ", fnum);
 }
 
 /* -- get the encoding of a font -- */
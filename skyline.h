@@ -0,0 +1,87 @@
+/*
+ * Range operations of the decoration skyline.
+ *
+ * This file is part of abcm2ps.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/* This file is included by deco.c and by the benchmark (bench.c).
+ * The benchmark includes it twice, with SKY() renaming the functions
+ * and with SKY_SCALAR to get the scalar versions. */
+
+#if defined(__SSE__) && !defined(SKY_SCALAR)
+#include <xmmintrin.h>
+#define SKY_SSE 1
+#endif
+#ifndef SKY
+#define SKY(f) f
+#endif
+
+/* -- get the max (up) or min (down) of n y offsets -- */
+static float SKY(y_range)(float *p, int n, int up)
+{
+	float y;
+	int i;
+
+	i = 1;
+	y = p[0];
+#ifdef SKY_SSE
+	if (n >= 8) {
+		__m128 m;
+
+		m = _mm_loadu_ps(p);
+		for (i = 4; i + 4 <= n; i += 4)
+			m = up ? _mm_max_ps(_mm_loadu_ps(p + i), m)
+			       : _mm_min_ps(_mm_loadu_ps(p + i), m);
+		m = up ? _mm_max_ps(m, _mm_movehl_ps(m, m))
+		       : _mm_min_ps(m, _mm_movehl_ps(m, m));
+		m = up ? _mm_max_ps(m, _mm_shuffle_ps(m, m, 1))
+		       : _mm_min_ps(m, _mm_shuffle_ps(m, m, 1));
+		y = _mm_cvtss_f32(m);
+	}
+#endif
+	if (up) {
+		for ( ; i < n; i++) {
+			if (y < p[i])
+				y = p[i];
+		}
+	} else {
+		for ( ; i < n; i++) {
+			if (y > p[i])
+				y = p[i];
+		}
+	}
+	return y;
+}
+
+/* -- raise (up) or lower (down) the y offsets i..j to y -- */
+static void SKY(y_bound)(float *p, int i, int j, float y, int up)
+{
+#ifdef SKY_SSE
+	__m128 v;
+
+	v = _mm_set1_ps(y);
+	for ( ; i + 3 <= j; i += 4)
+		_mm_storeu_ps(p + i,
+			up ? _mm_max_ps(v, _mm_loadu_ps(p + i))
+			   : _mm_min_ps(v, _mm_loadu_ps(p + i)));
+#endif
+	if (up) {
+		while (i <= j) {
+			if (p[i] < y)
+				p[i] = y;
+			i++;
+		}
+	} else {
+		while (i <= j) {
+			if (p[i] > y)
+				p[i] = y;
+			i++;
+		}
+	}
+}
+#undef SKY_SSE
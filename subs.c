@@ -18,6 +18,7 @@
 #include <time.h>
 #include <string.h>
 #include <ctype.h>
+#include <sys/stat.h>
 #ifdef HAVE_PANGO
 #include <pango/pangocairo.h>
 #include <pango/pangofc-font.h>
@@ -25,6 +26,13 @@
 
 #include "abcm2ps.h" 
 
+#if defined(unix) || defined(__unix__) || defined(HAVE_MMAP)
+#include <unistd.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 char tex_buf[TEX_BUF_SZ];	/* result of tex_str() */
 int outft = -1;			/* last font in the output file */
 
@@ -94,6 +102,8 @@ void error(int sev,	/* 0: warning, 1: error */
 	fprintf(stderr, "\n");
 	if (sev > severity)
 		severity = sev;
+	if (rcache_dir)
+		rcache_abort();		/* don't cache the messages */
 }
 
 /* -- capitalize a string -- */
@@ -136,14 +146,569 @@ float cwid(unsigned char c)
 	return (float) cw_tb[c] / 1000.;
 }
 
+/* -- font metrics -- */
+/* The character widths of a font may be loaded from a TrueType/OpenType
+ * (hmtx and cmap tables) or an AFM file by %%fontmetrics.
+ * They are kept by pages of 256 Unicode characters (BMP only)
+ * in 1/1000 of em, FM_NONE when the character is not in the font.
+ * The widths are saved in the binary file '<font file>.wid'
+ * which is mapped in memory by the next runs. */
+#define FM_NONE 0xffff
+static struct fmetrics {
+	unsigned short *page[256];
+	unsigned short *pgs;		/* pages from the .wid file */
+	size_t pgs_sz;			/* size of the .wid file */
+	char *fn;			/* font file */
+	long long mtime;
+} *fmetrics[MAXFONTS];
+
+static struct wid_hdr {		/* header of the .wid files */
+	char magic[8];
+	unsigned int size;		/* size of the font file */
+	unsigned int npages;
+	long long mtime;		/* modification time of the font file */
+	unsigned char idx[256];		/* page index + 1 */
+} wid_hdr;
+static const char wid_magic[8] = "abcmwid1";
+
+static void texw_reset(void);
+
+/* -- set the width of a character -- */
+static void fm_set(struct fmetrics *fm, unsigned u, int w)
+{
+	unsigned short *pg;
+	int i;
+
+	if (u > 0xffff || w < 0 || w >= FM_NONE)
+		return;
+	pg = fm->page[u >> 8];
+	if (!pg) {
+		pg = malloc(256 * sizeof *pg);
+		if (!pg)
+			return;
+		for (i = 0; i < 256; i++)
+			pg[i] = FM_NONE;
+		fm->page[u >> 8] = pg;
+	}
+	pg[u & 0xff] = w;
+}
+
+/* -- width of a character from the font metrics -- */
+static float fm_wid(struct fmetrics *fm,
+		unsigned char c,	/* first byte */
+		char *s)		/* next bytes */
+{
+	unsigned short *pg;
+	unsigned u;
+
+	u = c;
+	if (c >= 0xe0) {
+		if (c >= 0xf0 || s[0] == '\0')
+			return cwid('a');	/* not in BMP */
+		u = ((c & 0x0f) << 12) | ((s[0] & 0x3f) << 6) | (s[1] & 0x3f);
+	} else if (c >= 0xc0) {
+		u = ((c & 0x1f) << 6) | (s[0] & 0x3f);
+	}
+	pg = fm->page[u >> 8];
+	if (!pg || pg[u & 0xff] == FM_NONE)
+		return cwid(u < 0x80 ? u : 'a');
+	return (float) pg[u & 0xff] / 1000.;
+}
+
+#define BE16(p) (((p)[0] << 8) | (p)[1])
+#define BE32(p) (((unsigned) (p)[0] << 24) | ((p)[1] << 16) \
+			| ((p)[2] << 8) | (p)[3])
+
+/* -- get the widths from a TrueType/OpenType font -- */
+static int fm_ttf(struct fmetrics *fm, unsigned char *f, unsigned l)
+{
+	unsigned char *head, *hhea, *hmtx, *cmap, *p, *sub, *sub4, *sub12;
+	unsigned ntab, off, len, hmtx_l, cmap_l, sub_l, upem, nhm;
+	unsigned i, n, seg, c, c1, c2, g;
+
+	if (l < 12)
+		return -1;
+	ntab = BE16(f + 4);
+	if (12 + ntab * 16 > l)
+		return -1;
+	head = hhea = hmtx = cmap = NULL;
+	hmtx_l = cmap_l = 0;
+	for (i = 0, p = f + 12; i < ntab; i++, p += 16) {
+		off = BE32(p + 8);
+		len = BE32(p + 12);
+		if (off > l || len > l - off)
+			return -1;
+		if (memcmp(p, "head", 4) == 0 && len >= 54)
+			head = f + off;
+		else if (memcmp(p, "hhea", 4) == 0 && len >= 36)
+			hhea = f + off;
+		else if (memcmp(p, "hmtx", 4) == 0) {
+			hmtx = f + off;
+			hmtx_l = len;
+		} else if (memcmp(p, "cmap", 4) == 0 && len >= 4) {
+			cmap = f + off;
+			cmap_l = len;
+		}
+	}
+	if (!head || !hhea || !hmtx || !cmap)
+		return -1;
+	upem = BE16(head + 18);
+	nhm = BE16(hhea + 34);
+	if (upem == 0 || nhm == 0 || nhm * 4 > hmtx_l)
+		return -1;
+
+	/* search a Unicode subtable */
+	sub4 = sub12 = NULL;
+	n = BE16(cmap + 2);
+	if (4 + n * 8 > cmap_l)
+		return -1;
+	for (i = 0, p = cmap + 4; i < n; i++, p += 8) {
+		off = BE32(p + 4);
+		if (cmap_l < 16 || off > cmap_l - 16)
+			continue;
+		sub = cmap + off;
+		if (BE16(p) != 0 && BE16(p) != 3)	/* Unicode/Windows */
+			continue;
+		if (BE16(p) == 3 && BE16(p + 2) != 1 && BE16(p + 2) != 10)
+			continue;
+		switch (BE16(sub)) {
+		case 4:
+			sub4 = sub;
+			break;
+		case 12:
+			sub12 = sub;
+			break;
+		}
+	}
+	if (sub12) {
+		sub_l = BE32(sub12 + 4);
+		n = BE32(sub12 + 12);
+		if (sub_l > cmap_l - (sub12 - cmap)
+		 || sub_l < 16
+		 || n > (sub_l - 16) / 12)	/* (no overflow) */
+			return -1;
+		for (i = 0, p = sub12 + 16; i < n; i++, p += 12) {
+			c1 = BE32(p);
+			c2 = BE32(p + 4);
+			g = BE32(p + 8);
+			if (c2 > 0xffff)
+				c2 = 0xffff;
+			for (c = c1; c <= c2; c++, g++) {
+				if (g == 0)
+					continue;
+				off = g < nhm ? g : nhm - 1;
+				fm_set(fm, c, BE16(hmtx + off * 4)
+							* 1000 / upem);
+			}
+		}
+		return 0;
+	}
+	if (!sub4)
+		return -1;
+	sub_l = BE16(sub4 + 2);
+	seg = BE16(sub4 + 6) / 2;
+	if (sub_l > cmap_l - (sub4 - cmap)
+	 || 16 + seg * 8 > sub_l)
+		return -1;
+	for (i = 0; i < seg; i++) {
+		unsigned char *ro;
+		int delta;
+
+		c2 = BE16(sub4 + 14 + i * 2);
+		c1 = BE16(sub4 + 16 + seg * 2 + i * 2);
+		delta = BE16(sub4 + 16 + seg * 4 + i * 2);
+		ro = sub4 + 16 + seg * 6 + i * 2;
+		for (c = c1; c <= c2 && c != 0xffff; c++) {
+			if (BE16(ro) == 0) {
+				g = (c + delta) & 0xffff;
+			} else {
+				p = ro + BE16(ro) + (c - c1) * 2;
+				if (p + 2 > sub4 + sub_l)
+					break;
+				g = BE16(p);
+				if (g != 0)
+					g = (g + delta) & 0xffff;
+			}
+			if (g == 0)
+				continue;
+			off = g < nhm ? g : nhm - 1;
+			fm_set(fm, c, BE16(hmtx + off * 4) * 1000 / upem);
+		}
+	}
+	return 0;
+}
+
+/* glyph names of the ISO Latin-1 characters 0xa0..0xff */
+static const char *latin1_nm[96] = {
+	"space", "exclamdown", "cent", "sterling",
+	"currency", "yen", "brokenbar", "section",
+	"dieresis", "copyright", "ordfeminine", "guillemotleft",
+	"logicalnot", "hyphen", "registered", "macron",
+	"degree", "plusminus", "twosuperior", "threesuperior",
+	"acute", "mu", "paragraph", "periodcentered",
+	"cedilla", "onesuperior", "ordmasculine", "guillemotright",
+	"onequarter", "onehalf", "threequarters", "questiondown",
+	"Agrave", "Aacute", "Acircumflex", "Atilde",
+	"Adieresis", "Aring", "AE", "Ccedilla",
+	"Egrave", "Eacute", "Ecircumflex", "Edieresis",
+	"Igrave", "Iacute", "Icircumflex", "Idieresis",
+	"Eth", "Ntilde", "Ograve", "Oacute",
+	"Ocircumflex", "Otilde", "Odieresis", "multiply",
+	"Oslash", "Ugrave", "Uacute", "Ucircumflex",
+	"Udieresis", "Yacute", "Thorn", "germandbls",
+	"agrave", "aacute", "acircumflex", "atilde",
+	"adieresis", "aring", "ae", "ccedilla",
+	"egrave", "eacute", "ecircumflex", "edieresis",
+	"igrave", "iacute", "icircumflex", "idieresis",
+	"eth", "ntilde", "ograve", "oacute",
+	"ocircumflex", "otilde", "odieresis", "divide",
+	"oslash", "ugrave", "uacute", "ucircumflex",
+	"udieresis", "yacute", "thorn", "ydieresis",
+};
+
+/* -- get the widths from an AFM file -- */
+static int fm_afm(struct fmetrics *fm, char *f)
+{
+	char *p, nm[64];
+	int c, w, i, u;
+
+	p = strstr(f, "StartCharMetrics");
+	if (!p)
+		return -1;
+	for (;;) {
+		p = strchr(p, '\n');
+		if (!p)
+			break;
+		p++;
+		if (strncmp(p, "EndCharMetrics", 14) == 0)
+			break;
+		if (sscanf(p, "C %d ; WX %d ; N %63s", &c, &w, nm) != 3)
+			continue;
+		u = -1;
+		if (strncmp(nm, "uni", 3) == 0 && strlen(nm) == 7) {
+			sscanf(nm + 3, "%x", &u);
+		} else if (strcmp(nm, "quoteright") == 0) {
+			u = 0x2019;
+		} else if (strcmp(nm, "quoteleft") == 0) {
+			u = 0x2018;
+		} else if (strcmp(nm, "quotesingle") == 0) {
+			u = '\'';
+		} else if (strcmp(nm, "grave") == 0) {
+			u = '`';
+		} else if (c >= ' ' && c < 0x7f) {
+			u = c;
+		} else {
+			for (i = 1; i < 96; i++) {
+				if (strcmp(nm, latin1_nm[i]) == 0) {
+					u = 0xa0 + i;
+					break;
+				}
+			}
+		}
+		if (u >= 0)
+			fm_set(fm, u, w);
+	}
+	return 0;
+}
+
+/* -- get the widths from the binary cache -- */
+static int fm_wid_read(struct fmetrics *fm, char *fn, struct stat *sbuf)
+{
+	FILE *fp;
+	unsigned short *pgs;
+	struct stat wbuf;
+	size_t sz;
+	int i;
+
+	fp = fopen(fn, "rb");
+	if (!fp)
+		return -1;
+	if (fread(&wid_hdr, sizeof wid_hdr, 1, fp) != 1
+	 || memcmp(wid_hdr.magic, wid_magic, sizeof wid_magic) != 0
+	 || wid_hdr.size != (unsigned) sbuf->st_size
+	 || wid_hdr.mtime != (long long) sbuf->st_mtime
+	 || wid_hdr.npages > 256) {
+		fclose(fp);
+		return -1;
+	}
+	sz = sizeof wid_hdr + wid_hdr.npages * 256 * sizeof *pgs;
+	if (fstat(fileno(fp), &wbuf) != 0
+	 || wbuf.st_size != (off_t) sz) {	/* truncated file */
+		fclose(fp);
+		return -1;
+	}
+#ifdef HAVE_MMAP
+	pgs = mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+	fclose(fp);
+	if (pgs == MAP_FAILED)
+		return -1;
+	fm->pgs_sz = sz;
+	pgs = (unsigned short *) ((char *) pgs + sizeof wid_hdr);
+#else
+	sz -= sizeof wid_hdr;
+	pgs = malloc(sz);
+	if (!pgs || fread(pgs, 1, sz, fp) != sz) {
+		free(pgs);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+#endif
+	fm->pgs = pgs;
+	for (i = 0; i < 256; i++) {
+		if (wid_hdr.idx[i] != 0
+		 && wid_hdr.idx[i] <= wid_hdr.npages)
+			fm->page[i] = pgs + (wid_hdr.idx[i] - 1) * 256;
+	}
+	return 0;
+}
+
+/* -- save the widths in the binary cache -- */
+static void fm_wid_write(struct fmetrics *fm, char *fn, struct stat *sbuf)
+{
+	FILE *fp;
+	int i, ok;
+	char tmp[FILENAME_MAX];
+
+	memset(&wid_hdr, 0, sizeof wid_hdr);
+	memcpy(wid_hdr.magic, wid_magic, sizeof wid_magic);
+	wid_hdr.size = sbuf->st_size;
+	wid_hdr.mtime = sbuf->st_mtime;
+	for (i = 0; i < 256; i++) {
+		if (fm->page[i])
+			wid_hdr.idx[i] = ++wid_hdr.npages;
+	}
+
+	/* write in a temporary file, so that the other runs
+	 * never see a partial file */
+#if defined(unix) || defined(__unix__)
+	snprintf(tmp, sizeof tmp, "%s.%ld", fn, (long) getpid());
+#else
+	snprintf(tmp, sizeof tmp, "%s.tmp", fn);
+#endif
+	fp = fopen(tmp, "wb");
+	if (!fp)
+		return;				/* no cache */
+	ok = fwrite(&wid_hdr, sizeof wid_hdr, 1, fp) == 1;
+	for (i = 0; i < 256; i++) {
+		if (fm->page[i]
+		 && fwrite(fm->page[i], sizeof *fm->page[i], 256, fp) != 256)
+			ok = 0;
+	}
+	if (fclose(fp) != 0 || !ok || rename(tmp, fn) != 0)
+		remove(tmp);
+}
+
+/* -- free the metrics of a font -- */
+static void fm_free(struct fmetrics *fm)
+{
+	int i;
+
+	if (fm->pgs) {
+#ifdef HAVE_MMAP
+		munmap((char *) fm->pgs - sizeof wid_hdr, fm->pgs_sz);
+#else
+		free(fm->pgs);
+#endif
+	} else {
+		for (i = 0; i < 256; i++)
+			free(fm->page[i]);
+	}
+	free(fm->fn);
+	free(fm);
+}
+
+/* -- load the metrics of a font -- */
+int fmetrics_load(int fnum, char *fn)
+{
+	struct fmetrics *fm;
+	struct stat sbuf;
+	FILE *fp;
+	char *f, *wfn, rfn[256];
+	size_t l;
+	int ret;
+
+	if (strlen(fn) >= sizeof rfn - 8) {
+		error(1, NULL, "Font file name too long");
+		return -1;
+	}
+	fp = open_file(fn, "ttf", rfn);
+	if (!fp
+	 || fstat(fileno(fp), &sbuf) < 0) {
+		error(1, NULL, "Cannot open the font file %s", fn);
+		if (fp)
+			fclose(fp);
+		return -1;
+	}
+
+	/* same font file as before */
+	fm = fmetrics[fnum];
+	if (fm && strcmp(fm->fn, rfn) == 0
+	 && fm->mtime == (long long) sbuf.st_mtime) {
+		fclose(fp);
+		return 0;
+	}
+
+	fm = calloc(1, sizeof *fm);
+	wfn = malloc(strlen(rfn) + 5);
+	if (fm)
+		fm->fn = strdup(rfn);
+	if (!fm || !wfn || !fm->fn) {
+		error(1, NULL, "Out of memory");
+		exit(EXIT_FAILURE);
+	}
+	sprintf(wfn, "%s.wid", rfn);
+	if (fm_wid_read(fm, wfn, &sbuf) == 0) {
+		fclose(fp);
+		goto ok;
+	}
+
+	l = sbuf.st_size;
+	f = malloc(l + 1);
+	if (!f) {
+		error(1, NULL, "Out of memory");
+		exit(EXIT_FAILURE);
+	}
+	if (fread(f, 1, l, fp) != l) {
+		ret = -1;
+	} else {
+		f[l] = '\0';
+		if (strncmp(f, "StartFontMetrics", 16) == 0)
+			ret = fm_afm(fm, f);
+		else
+			ret = fm_ttf(fm, (unsigned char *) f, l);
+	}
+	fclose(fp);
+	free(f);
+	if (ret < 0) {
+		error(1, NULL, "Bad font file %s", rfn);
+		fm_free(fm);
+		free(wfn);
+		return -1;
+	}
+	fm_wid_write(fm, wfn, &sbuf);
+ok:
+	free(wfn);
+	fm->mtime = sbuf.st_mtime;
+	if (fmetrics[fnum])
+		fm_free(fmetrics[fnum]);
+	fmetrics[fnum] = fm;
+	texw_reset();
+	return 0;
+}
+
+/* -- check if a font has metrics -- */
+int fmetrics_have(int fnum)
+{
+	return fmetrics[fnum] != NULL;
+}
+
+/* string width cache */
+#define TEXW_NB 1024		/* number of entries */
+#define TEXW_HSZ 2048		/* size of the hash table */
+#define TEXW_LEN 32		/* max length of the cached strings */
+static struct texw {
+	struct texw *hnext;		/* hash link */
+	struct texw *prev, *next;	/* LRU list */
+	unsigned h;
+	int ft, fnum;
+	float swfac, w;
+	char str[TEXW_LEN];
+	char res[TEXW_LEN * 4];		/* tex_buf */
+} texw_tb[TEXW_NB], *texw_htb[TEXW_HSZ], texw_lru;
+static int texw_n;
+int texw_hit, texw_miss;
+
+/* -- search a string in the width cache -- */
+/* *ph is set to 0 if the string cannot be cached. */
+static struct texw *texw_get(char *s, int ft, int fnum, float swfac,
+				unsigned *ph)
+{
+	struct texw *e;
+	unsigned char *p;
+	unsigned h;
+
+	h = (2166136261u ^ ft) * 16777619 ^ fnum;
+	for (p = (unsigned char *) s; *p != '\0'; p++) {
+		if (*p == '$' || *p == '&'	/* font change or XML */
+		 || p - (unsigned char *) s >= TEXW_LEN - 1) {
+			*ph = 0;
+			return NULL;
+		}
+		h = (h ^ *p) * 16777619;
+	}
+	h |= 1;
+	*ph = h;
+	for (e = texw_htb[h % TEXW_HSZ]; e; e = e->hnext) {
+		if (e->h == h && e->ft == ft && e->fnum == fnum
+		 && e->swfac == swfac
+		 && strcmp(e->str, s) == 0)
+			break;
+	}
+	if (!e) {
+		texw_miss++;
+		return NULL;
+	}
+	texw_hit++;
+	if (texw_lru.next != e) {	/* move to the head of the LRU list */
+		e->prev->next = e->next;
+		e->next->prev = e->prev;
+		e->next = texw_lru.next;
+		e->prev = &texw_lru;
+		e->next->prev = e;
+		texw_lru.next = e;
+	}
+	return e;
+}
+
+/* -- add a string width in the cache -- */
+static void texw_add(char *s, int ft, int fnum, float swfac,
+			unsigned h, float w)
+{
+	struct texw *e, **pe;
+
+	if (texw_n < TEXW_NB) {
+		if (texw_n == 0)
+			texw_lru.next = texw_lru.prev = &texw_lru;
+		e = &texw_tb[texw_n++];
+	} else {
+		e = texw_lru.prev;		/* remove the oldest entry */
+		for (pe = &texw_htb[e->h % TEXW_HSZ]; *pe != e; )
+			pe = &(*pe)->hnext;
+		*pe = e->hnext;
+		e->prev->next = &texw_lru;
+		texw_lru.prev = e->prev;
+	}
+	e->h = h;
+	e->ft = ft;
+	e->fnum = fnum;
+	e->swfac = swfac;
+	e->w = w;
+	strcpy(e->str, s);
+	strcpy(e->res, tex_buf);
+	e->hnext = texw_htb[h % TEXW_HSZ];
+	texw_htb[h % TEXW_HSZ] = e;
+	e->next = texw_lru.next;
+	e->prev = &texw_lru;
+	e->next->prev = e;
+	texw_lru.next = e;
+}
+
+/* -- clear the width cache -- */
+static void texw_reset(void)
+{
+	texw_n = 0;
+	memset(texw_htb, 0, sizeof texw_htb);
+}
+
 /* -- change string taking care of some tex-style codes -- */
-/* Return an estimated width of the string. */
-float tex_str(char *s)
+static float tex_str1(char *s)
 {
 	char *d, *p;
 	unsigned char c1;
 	unsigned maxlen, i;
 	float w, swfac;
+	struct fmetrics *fm;
 
 	w = 0;
 	d = tex_buf;
@@ -151,6 +716,7 @@ float tex_str(char *s)
 	if ((i = curft) <= 0)
 		i = defft;
 	swfac = cfmt.font_tb[i].swfac;
+	fm = fmetrics[cfmt.font_tb[i].fnum];
 	while (1) {
 		c1 = (unsigned char) *s++;
 		if (c1 == '\0')
@@ -178,6 +744,7 @@ float tex_str(char *s)
 				if (i == 0)
 					i = defft;
 				swfac = cfmt.font_tb[i].swfac;
+				fm = fmetrics[cfmt.font_tb[i].fnum];
 				if (--maxlen <= 0)
 					break;
 				*d++ = c1;
@@ -252,8 +819,9 @@ float tex_str(char *s)
 			break;
 		}
 		if (c1 >= 0x80) {
-			if (c1 >= 0xc0)
-				w += cwid('a') * swfac;	// start of unicode char
+			if (c1 >= 0xc0)		// start of unicode char
+				w += (fm ? fm_wid(fm, c1, s) : cwid('a'))
+						* swfac;
 		} else if (c1 <= 5) {		/* accidentals from gchord */
 			if (--maxlen < 4)
 				break;
@@ -289,7 +857,7 @@ float tex_str(char *s)
 			w += cwid('a') * swfac;
 			continue;
 		} else {
-			w += cwid(c1) * swfac;
+			w += (fm ? fm_wid(fm, c1, s) : cwid(c1)) * swfac;
 		}
 	addchar_nowidth:
 		if (--maxlen <= 0)
@@ -302,6 +870,30 @@ float tex_str(char *s)
 	return w;
 }
 
+/* -- change string taking care of some tex-style codes -- */
+/* Return an estimated width of the string. */
+float tex_str(char *s)
+{
+	struct texw *e;
+	unsigned h;
+	int ft, fnum;
+	float swfac, w;
+
+	if ((ft = curft) <= 0)
+		ft = defft;
+	fnum = cfmt.font_tb[ft].fnum;	/* (the metrics depend on the font) */
+	swfac = cfmt.font_tb[ft].swfac;
+	e = texw_get(s, ft, fnum, swfac, &h);
+	if (e) {
+		strcpy(tex_buf, e->res);
+		return e->w;
+	}
+	w = tex_str1(s);
+	if (h != 0)
+		texw_add(s, ft, fnum, swfac, h, w);
+	return w;
+}
+
 #ifdef HAVE_PANGO
 #define PG_SCALE (PANGO_SCALE * 72 / 96)	/* 96 DPI */
 
@@ -1616,7 +2208,8 @@ static void write_headform(float lwidth)
 						a2b("%% --- titlesub");
 					a2b(" %s\n", &s->text[2]);
 				}
-				a2b("%.1f %.1f M ", x, -y);
+				emit_xy(x, -y);
+				emit_op("M ");
 			}
 			if (*p == 125) {	/* concatenate */
 			    p += 2;
@@ -1682,7 +2275,8 @@ static void write_headform(float lwidth)
 			if (inf_nb[i] == 1) {
 				while (s) {
 					y += sz;
-					a2b("%.1f %.1f M ", x, -y);
+					emit_xy(x, -y);
+					emit_op("M ");
 					put_inf2r(s, 0, align);
 					s = s->next;
 				}
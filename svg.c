@@ -35,29 +35,123 @@ enum elt_t {			/* element types */
 struct elt_s {
 	struct elt_s *next;
 	char type;
+	char shared;		/* SEQ/BRK: the list is shared (read only) */
+	short nm;		/* STR: index of the name when executable */
 	union {
 		float v;
 		char *s;
 		struct elt_s *e;
 	} u;
 };
+struct code_s {			/* compiled procedure item */
+	char type;
+#define CD_VAL 0			/* push a value */
+#define CD_OP 1				/* execute a name */
+#define CD_LIT 2			/* push a literal (see elt_ref()) */
+	short nm;		/* CD_OP: name index */
+	union {
+		float v;
+		struct elt_s *e;
+	} u;
+};
 struct ps_sym_s {
 	char *n;		/* name */
-	struct elt_s *e;	/* value */
+	struct elt_s *e;	/* value (PostScript definition) */
+	struct code_s *code;	/* compiled procedure */
+	int ncode;
+	int code_sz;		/* allocated size of 'code' */
+	struct code_old *old;	/* code replaced when running */
 	int exec;		/* current number of execution */
+	char shared;		/* the lists of the value are shared */
+};
+struct code_old {
+	struct code_old *next;
+	struct code_s *code;
 };
 
 /* -- PostScript tiny interpreter -- */
 #define NELTS 2048	/* number of elements per block */
-#define NSYMS 512	/* max number of symbols */
+#define NSYMS 2048	/* max number of names */
+#define NHASH (NSYMS * 2)	/* size of the name hash table (power of 2) */
 static struct elt_s *elts;
 static struct elt_s *stack, *free_elt;
-static struct ps_sym_s ps_sym[NSYMS];
+static struct ps_sym_s ps_sym[NSYMS];	/* names - index = builtin operator */
+static short sym_hash[NHASH];		/* name indexes */
 static int n_sym;
 static int ps_error;
 static int in_cnt;			/* in [..] or {..} */
-static char *path;
-static char path_buf[256];
+
+/* builtin operators */
+enum op_e {
+	O_none, O_store, O_accent, O_abs, O_add, O_and, O_anshow, O_arc, O_arcn,
+	O_arp, O_atan, O_bar, O_bclef, O_bdef, O_bind, O_bitshift, O_bm,
+	O_bnum, O_bnumb, O_box, O_boxdraw, O_boxmark, O_boxend, O_brace,
+	O_bracket, O_breve, O_brth, O_C, O_cclef, O_csig, O_ctsig, O_coda,
+	O_closepath, O_composefont, O_copy, O_cos, O_cpu, O_crdc, O_cresc,
+	O_custos, O_currentgray, O_currentpoint, O_curveto, O_cvi, O_cvx,
+	O_dacs, O_def, O_dim, O_div, O_dnb, O_dplus, O_dSL, O_dt, O_dotbar,
+	O_dup, O_dft0, O_dsh0, O_emb, O_eofill, O_eq, O_exch, O_exec, O_false,
+	O_fill, O_findfont, O_fng, O_for, O_forall, O_ft0, O_ft1, O_ft4,
+	O_ft513, O_gcshow, O_ge, O_get, O_getinterval, O_ghd, O_ghl, O_glisq,
+	O_gliss, O_gt, O_gu, O_gd, O_gua, O_gda, O_grestore, O_grm, O_gsave,
+	O_gsl, O_gxshow, O_Hd, O_HD, O_HDD, O_hd, O_hl, O_hl1, O_hl2, O_hld,
+	O_hyph, O_idiv, O_if, O_ifelse, O_imsig, O_iMsig, O_index, O_jshow,
+	O_L, O_le, O_lt, O_length, O_lineto, O_lmrd, O_load, O_longa, O_lphr,
+	O_ltr, O_lyshow, O_M, O_marcato, O_moveto, O_mphr, O_mod, O_mrep,
+	O_mrep2, O_mrest, O_mul, O_ne, O_neg, O_newpath, O_nt0, O_o8va,
+	O_o8vb, O_oct, O_opend, O_or, O_pclef, O_ped, O_pedoff, O_pf, O_pmsig,
+	O_pMsig, O_pop, O_pshhd, O_pdshhd, O_pfthd, O_pdfthd, O_RC, O_RL,
+	O_RM, O_r00, O_r0, O_r1, O_r2, O_r4, O_r8, O_r16, O_r32, O_r64,
+	O_r128, O_rdots, O_rcurveto, O_rlineto, O_rmoveto, O_roll, O_repbra,
+	O_repeat, O_rotate, O_SL, O_SLW, O_scale, O_scalefont, O_search,
+	O_selectfont, O_sep0, O_setdash, O_setfont, O_setgray, O_setlinewidth,
+	O_sfu, O_sfd, O_sfs, O_sgu, O_sgd, O_sgs, O_sfz, O_sgno, O_show,
+	O_showb, O_showc, O_showr, O_showerror, O_sld, O_snap, O_sphr,
+	O_spclef, O_setrgbcolor, O_stc, O_stroke, O_su, O_sd, O_stsig, O_sub,
+	O_sbclef, O_scclef, O_sh0, O_sh1, O_sh4, O_sh513, O_srep, O_stclef,
+	O_stringwidth, O_svg, O_T, O_tclef, O_thbar, O_thumb, O_translate,
+	O_trem, O_trl, O_true, O_tsig, O_tubr, O_tubrl, O_turn, O_turnx,
+	O_upb, O_umrd, O_wedge, O_wln, O_where, O_xydef, O_xymove,
+	O_exit, O_dlw,			/* not builtin */
+	NOPS
+};
+static char *op_tb[NOPS] = {
+	0, "!", "accent", "abs", "add", "and", "anshow", "arc", "arcn", "arp",
+	"atan", "bar", "bclef", "bdef", "bind", "bitshift", "bm", "bnum",
+	"bnumb", "box", "boxdraw", "boxmark", "boxend", "brace", "bracket",
+	"breve", "brth", "C", "cclef", "csig", "ctsig", "coda", "closepath",
+	"composefont", "copy", "cos", "cpu", "crdc", "cresc", "custos",
+	"currentgray", "currentpoint", "curveto", "cvi", "cvx", "dacs", "def",
+	"dim", "div", "dnb", "dplus", "dSL", "dt", "dotbar", "dup", "dft0",
+	"dsh0", "emb", "eofill", "eq", "exch", "exec", "false", "fill",
+	"findfont", "fng", "for", "forall", "ft0", "ft1", "ft4", "ft513",
+	"gcshow", "ge", "get", "getinterval", "ghd", "ghl", "glisq", "gliss",
+	"gt", "gu", "gd", "gua", "gda", "grestore", "grm", "gsave", "gsl",
+	"gxshow", "Hd", "HD", "HDD", "hd", "hl", "hl1", "hl2", "hld", "hyph",
+	"idiv", "if", "ifelse", "imsig", "iMsig", "index", "jshow", "L", "le",
+	"lt", "length", "lineto", "lmrd", "load", "longa", "lphr", "ltr",
+	"lyshow", "M", "marcato", "moveto", "mphr", "mod", "mrep", "mrep2",
+	"mrest", "mul", "ne", "neg", "newpath", "nt0", "o8va", "o8vb", "oct",
+	"opend", "or", "pclef", "ped", "pedoff", "pf", "pmsig", "pMsig",
+	"pop", "pshhd", "pdshhd", "pfthd", "pdfthd", "RC", "RL", "RM", "r00",
+	"r0", "r1", "r2", "r4", "r8", "r16", "r32", "r64", "r128", "rdots",
+	"rcurveto", "rlineto", "rmoveto", "roll", "repbra", "repeat",
+	"rotate", "SL", "SLW", "scale", "scalefont", "search", "selectfont",
+	"sep0", "setdash", "setfont", "setgray", "setlinewidth", "sfu", "sfd",
+	"sfs", "sgu", "sgd", "sgs", "sfz", "sgno", "show", "showb", "showc",
+	"showr", "showerror", "sld", "snap", "sphr", "spclef", "setrgbcolor",
+	"stc", "stroke", "su", "sd", "stsig", "sub", "sbclef", "scclef",
+	"sh0", "sh1", "sh4", "sh513", "srep", "stclef", "stringwidth", "svg",
+	"T", "tclef", "thbar", "thumb", "translate", "trem", "trl", "true",
+	"tsig", "tubr", "tubrl", "turn", "turnx", "upb", "umrd", "wedge",
+	"wln", "where", "xydef", "xymove",
+	"exit", "dlw",
+};
+static char *path;		/* current graphic path, kept between the paths */
+static int path_len, path_sz;	/* length of the path, size of the buffer */
+static char path_op;		/* last relative command (l, h, v or m) */
+static char path_mv;		/* a relative move is pending */
+static float path_mx, path_my;
 
 /* graphical context */
 static struct gc {
@@ -78,6 +172,7 @@ static int g;			/* current container */
 static int boxend;
 static char *defs;		// SVG ID's from %%beginsvg
 static int defssz;
+static char shared_done;	// shared definitions in the output file
 
 /* abcm2ps definitions */
 static struct {
@@ -728,7 +823,161 @@ void svg_font_switch(void)
 }
 
 /* PS functions */
-static void ps_exec(char *op);
+static void ps_exec(int n);
+
+/* -- string storage --
+ * The strings of the elements are allocated in an arena which is
+ * cleared at the end of the pages.
+ * The strings which are kept in the definitions are moved to a table
+ * which is never cleared, so that they are allocated only once even
+ * when the interpreter is reset (new SVG file).
+ * As the user definitions are run again on each page, an unchanged
+ * definition keeps its previous value (see ps_sym_def()).
+ * Then, once the arena is large enough, there is no heap allocation
+ * when the pages are generated.
+ * The executable names point to the name table.
+ * The byte before a string tells where it is
+ * (0: arena, 1: heap, 2: static or name table, 3: kept string table). */
+#define STRBLKSZ 8192		/* size of the arena blocks */
+struct strblk {
+	struct strblk *next;
+	char b[STRBLKSZ];
+};
+static struct strblk *strblks, *strblk;	/* arena: first and current blocks */
+static int strblk_off;			/* offset in the current block */
+struct kstr {
+	struct kstr *next;
+	char b[2];		/* 3 and the string */
+};
+#define NKSTR 256		/* size of the kept string hash table */
+#define KSTR_MAX (256 * 1024)	/* max memory of the kept strings */
+static struct kstr *kstr_tb[NKSTR];
+static int kstr_sz;
+int svg_nalloc, svg_npages;		/* heap allocations and pages (--profile) */
+static char str_brace[] = "\2{", str_bracket[] = "\2[";
+
+/* heap allocation */
+static void *svg_malloc(size_t sz)
+{
+	void *p;
+
+	p = malloc(sz);
+	if (!p) {
+		error(1, NULL, "Out of memory for SVG - abort");
+		exit(EXIT_FAILURE);
+	}
+	svg_nalloc++;
+	return p;
+}
+
+/* allocate a string (l = length with the ending '\0') */
+static char *str_new(int l)
+{
+	struct strblk *blk;
+	char *s;
+
+	l++;
+	if (l > STRBLKSZ) {
+		s = svg_malloc(l);
+		*s = 1;
+		return s + 1;
+	}
+	if (!strblk || strblk_off + l > STRBLKSZ) {
+		blk = strblk ? strblk->next : strblks;
+		if (!blk) {
+			blk = svg_malloc(sizeof *blk);
+			blk->next = NULL;
+			if (strblk)
+				strblk->next = blk;
+			else
+				strblks = blk;
+		}
+		strblk = blk;
+		strblk_off = 0;
+	}
+	s = &strblk->b[strblk_off];
+	strblk_off += l;
+	*s = 0;
+	return s + 1;
+}
+
+static char *str_dup(char *s)
+{
+	char *d;
+	int l;
+
+	l = strlen(s) + 1;
+	d = str_new(l);
+	memcpy(d, s, l);
+	return d;
+}
+
+/* get a string which may be modified */
+static char *str_w(char *s)
+{
+	return s[-1] >= 2 ? str_dup(s) : s;
+}
+
+static void str_free(char *s)
+{
+	if (s[-1] == 1)
+		free(s - 1);
+}
+
+/* get a string from the kept string table */
+static char *str_kept(char *s)
+{
+	struct kstr *k;
+	unsigned h;
+	char *p;
+	int l;
+
+	h = 2166136261u;
+	for (p = s; *p; p++)
+		h = (h ^ (unsigned char) *p) * 16777619;
+	l = p - s + 1;
+	for (k = kstr_tb[h % NKSTR]; k; k = k->next) {
+		if (strcmp(&k->b[1], s) == 0)
+			return &k->b[1];
+	}
+	if (kstr_sz + l > KSTR_MAX) {		/* too many strings */
+		p = svg_malloc(l + 1);
+		*p++ = 1;
+		memcpy(p, s, l);
+		return p;
+	}
+	k = svg_malloc(sizeof *k + l);
+	kstr_sz += l;
+	k->b[0] = 3;
+	memcpy(&k->b[1], s, l);
+	k->next = kstr_tb[h % NKSTR];
+	kstr_tb[h % NKSTR] = k;
+	return &k->b[1];
+}
+
+/* move the strings of an element out of the arena */
+static void str_keep(struct elt_s *e)
+{
+	switch (e->type) {
+	case STR:
+		if (e->u.s[-1])
+			break;
+		e->u.s = str_kept(e->u.s);
+		break;
+	case SEQ:
+	case BRK:
+		for (e = e->u.e; e; e = e->next)
+			str_keep(e);
+		break;
+	}
+}
+
+/* clear the arena at end of page */
+static void str_reset(void)
+{
+	strblk = NULL;
+	svg_npages++;
+}
 
 static void elts_link(struct elt_s *e)
 {
@@ -738,7 +987,7 @@ static void elts_link(struct elt_s *e)
 	for (i = 1; i < NELTS - 1; i++) {
 		e[i].next = &e[i + 1];
 		if (e[i].type == STR)
-			free(e[i].u.s);
+			str_free(e[i].u.s);
 		e[i].type = VAL;
 	}
 	e[NELTS - 1].next = NULL;
@@ -781,6 +1030,8 @@ static struct elt_s *elt_new(void)
 	free_elt = e->next;
 	e->next = NULL;
 	e->type = VAL;
+	e->shared = 0;
+	e->nm = 0;
 	return e;
 }
 
@@ -792,13 +1043,13 @@ static void elt_free(struct elt_s *e)
 	free_elt = e;
 	switch (e->type) {
 	case STR:
-		free(e->u.s);
+		str_free(e->u.s);
 		e->type = VAL;
 		e->u.v = 0;
 		break;
 	case SEQ:
 	case BRK:
-		e2 = e->u.e;
+		e2 = e->shared ? NULL : e->u.e;
 		e->type = VAL;
 		e->u.v = 0;
 		while (e2) {
@@ -810,10 +1061,35 @@ static void elt_free(struct elt_s *e)
 	}
 }
 
+static struct elt_s *elt_dup(struct elt_s *e);
+
+/* reference to an element of a definition
+ * The lists are shared, so the definition must not be freed
+ * (see ps_sym_def()). */
+static struct elt_s *elt_ref(struct elt_s *e)
+{
+	struct elt_s *e2;
+
+	switch (e->type) {
+	case SEQ:
+	case BRK:
+		e2 = elt_new();
+		if (!e2)
+			return e2;
+		e2->type = e->type;
+		e2->shared = 1;
+		e2->u.e = e->u.e;
+		return e2;
+	}
+	return elt_dup(e);
+}
+
 static struct elt_s *elt_dup(struct elt_s *e)
 {
 	struct elt_s *e2, *e3, *e4;
 
+	if (e->shared)
+		return elt_ref(e);
 	e2 = elt_new();
 	if (!e2)
 		return e2;
@@ -823,7 +1099,8 @@ static struct elt_s *elt_dup(struct elt_s *e)
 		e2->u.v = e->u.v;
 		break;
 	case STR:
-		e2->u.s = strdup(e->u.s);
+		e2->u.s = e->u.s[-1] >= 2 ? e->u.s : str_dup(e->u.s);
+		e2->nm = e->nm;
 		break;
 	case SEQ:
 	case BRK:
@@ -885,41 +1162,182 @@ static void elt_lst_dump(struct elt_s *e)
 	} while (e);
 }
 
-static struct ps_sym_s *ps_sym_lookup(char *name)
+static void syms_init(void);
+
+/* get the index of a name, creating it if needed */
+static int sym_get(char *name)
 {
-	struct ps_sym_s *ps;
+	unsigned char *p;
+	unsigned h;
+	int i;
 
 	if (n_sym == 0)
-		return NULL;
-	ps = &ps_sym[n_sym];
+		syms_init();
+	h = 0;
+	for (p = (unsigned char *) name; *p; p++)
+		h = h * 31 + *p;
 	for (;;) {
-		ps--;
-		if (strcmp(ps->n, name) == 0)
+		h &= NHASH - 1;
+		i = sym_hash[h];
+		if (i == 0)
 			break;
-		if (ps == ps_sym)
-			return NULL;
+		if (strcmp(ps_sym[i].n, name) == 0)
+			return i;
+		h++;
+	}
+	if (n_sym >= NSYMS) {
+		fprintf(stderr, "svg: Too many PS symbols\n");
+		ps_error = 1;
+		return 0;
+	}
+	i = n_sym++;
+	p = svg_malloc(p - (unsigned char *) name + 2);
+	*p = 2;
+	strcpy((char *) p + 1, name);
+	ps_sym[i].n = (char *) p + 1;
+	sym_hash[h] = i;
+	return i;
+}
+
+/* create the names of the builtin operators */
+static void syms_init(void)
+{
+	int i;
+
+	n_sym = 1;
+	ps_sym[0].n = &str_brace[2];		/* "" */
+	for (i = 1; i < NOPS; i++)
+		sym_get(op_tb[i]);
+}
+
+/* free the code of a procedure which was redefined when running */
+static void code_old_free(struct ps_sym_s *ps)
+{
+	struct code_old *o;
+
+	while (ps->old) {
+		o = ps->old;
+		ps->old = o->next;
+		free(o->code);
+		free(o);
+	}
+}
+
+/* remove the PostScript definitions
+ * (the elements are freed by elts_reset()) */
+static void syms_reset(void)
+{
+	int i;
+
+	for (i = 0; i < n_sym; i++) {
+		ps_sym[i].e = NULL;
+		ps_sym[i].ncode = 0;		/* (the code array is kept) */
+		ps_sym[i].exec = 0;
+		ps_sym[i].shared = 0;
+		code_old_free(&ps_sym[i]);
+	}
+}
+
+static struct ps_sym_s *ps_sym_lookup(char *name)
+{
+	struct ps_sym_s *ps;
+
+	ps = &ps_sym[sym_get(name)];
+	return ps->e ? ps : NULL;
+}
+
+/* check if two elements have the same value */
+static int elt_same(struct elt_s *e1, struct elt_s *e2)
+{
+	if (e1->type != e2->type)
+		return 0;
+	switch (e1->type) {
+	case VAL:
+		return e1->u.v == e2->u.v;
+	case STR:
+		return strcmp(e1->u.s, e2->u.s) == 0;
+	}
+	for (e1 = e1->u.e, e2 = e2->u.e; e1 && e2;
+	     e1 = e1->next, e2 = e2->next) {
+		if (!elt_same(e1, e2))
+			return 0;
+	}
+	return e1 == e2;
+}
+
+/* compile a procedure */
+static void code_new(struct ps_sym_s *ps)
+{
+	struct elt_s *e;
+	struct code_s *c;
+	int n;
+
+	if (ps->exec && ps->code) {	/* redefined when running */
+		struct code_old *o;
+
+		o = svg_malloc(sizeof *o);
+		o->code = ps->code;
+		o->next = ps->old;
+		ps->old = o;
+		ps->code = NULL;
+		ps->code_sz = 0;
+	}
+	ps->ncode = 0;
+	ps->shared = 0;
+	if (ps->e->type != SEQ)
+		return;
+	n = 0;
+	for (e = ps->e->u.e; e; e = e->next)
+		n++;
+	if (n == 0)
+		return;
+	if (n > ps->code_sz) {
+		free(ps->code);
+		ps->code = svg_malloc(sizeof *c * n);
+		ps->code_sz = n;
+	}
+	c = ps->code;
+	ps->ncode = n;
+	for (e = ps->e->u.e; e; e = e->next, c++) {
+		switch (e->type) {
+		case VAL:
+			c->type = CD_VAL;
+			c->u.v = e->u.v;
+			continue;
+		case STR:
+			if (e->u.s[0] == '/' || e->u.s[0] == '(')
+				break;
+			c->type = CD_OP;
+			c->nm = e->nm ? e->nm : sym_get(e->u.s);
+			continue;
+		case SEQ:
+		case BRK:
+			ps->shared = 1;
+			break;
+		}
+		c->type = CD_LIT;
+		c->u.e = e;
 	}
-	return ps;
 }
 
 static struct ps_sym_s *ps_sym_def(char *name, struct elt_s *e)
 {
 	struct ps_sym_s *ps;
 
-	ps = ps_sym_lookup(name);
-	if (ps) {
-		elt_free(ps->e);
-	} else {
-		if (n_sym >= NSYMS) {
-			fprintf(stderr, "svg: Too many PS symbols\n");
-			ps_error = 1;
-			return NULL;
+	ps = &ps_sym[sym_get(name)];
+	if (ps->e) {
+		if (elt_same(ps->e, e)) {	/* (definitions run on each page) */
+			elt_free(e);
+			return ps;
 		}
-		ps = &ps_sym[n_sym++];
-		ps->n = strdup(name);
+
+		/* if the value may be in use, it is freed on reset */
+		if (!ps->exec && !ps->shared)
+			elt_free(ps->e);
 	}
+	str_keep(e);
 	ps->e = e;
-	ps->exec = 0;
+	code_new(ps);
 	return ps;
 }
 
@@ -1020,8 +1438,8 @@ static void cond(int type)
 			fprintf(stderr, "svg: String condition not treated\n");
 			break;
 		}
-		free(s);
-		free(s2);
+		str_free(s);
+		str_free(s2);
 		stack->type = VAL;
 		return;
 	}
@@ -1030,13 +1448,13 @@ static void cond(int type)
 	if (stack->type == STR) {
 		s = stack->u.s;
 		stack->u.v = s[1];
-		free(s);
+		str_free(s);
 		stack->type = VAL;
 	}
 	if (stack->next->type == STR) {
 		s = stack->next->u.s;
 		stack->next->u.v = s[1];
-		free(s);
+		str_free(s);
 		stack->next->type = VAL;
 	}
 	v = pop_free_val();
@@ -1173,6 +1591,27 @@ static void define_head(float w, float h)
 	fputs(svg_head2, fout);
 }
 
+/* -- output all the symbol definitions in a hidden image -- */
+/* (--shared-defs) the other images of the document refer to them */
+static void shared_defs_out(void)
+{
+	unsigned i;
+
+	fputs("<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\"\n"
+		"\txmlns:xlink=\"http://www.w3.org/1999/xlink\"\n"
+		"\twidth=\"0\" height=\"0\" style=\"position:absolute\">\n"
+		"<defs>\n", fout);
+	for (i = 0; i < sizeof def_tb / sizeof def_tb[0]; i++) {
+		if (def_tb[i].defined == 2)	/* from %%beginsvg */
+			continue;
+		fputs(def_tb[i].def, fout);
+		def_tb[i].defined = 3;		/* (don't erase) */
+	}
+	fputs("</defs>\n"
+		"</svg>\n", fout);
+	shared_done = 1;
+}
+
 /* -- output the symbol definitions -- */
 void define_svg_symbols(char *title, int num, float w, float h)
 {
@@ -1211,6 +1650,8 @@ void define_svg_symbols(char *title, int num, float w, float h)
 				"</head>\n"
 				"<body>\n",
 				s);
+			if (shared_defs)
+				shared_defs_out();
 		} else {
 			fputs("<br/>\n", fout);
 		}
@@ -1222,6 +1663,8 @@ void define_svg_symbols(char *title, int num, float w, float h)
 //				"<rect width=\"100%%\" height=\"100%%\" fill=\"%s\"/>\n",
 //				cfmt.bgcolor);
 	} else {				/* -g, -v or -z */
+		if (epsf == 3 && shared_defs && !shared_done)
+			shared_defs_out();
 		if (epsf != 3) {
 			if (fout != stdout)
 				fputs("<?xml version=\"1.0\" standalone=\"no\"?>\n"
@@ -1262,10 +1705,11 @@ void define_svg_symbols(char *title, int num, float w, float h)
 		return;
 
 	elts_reset();
-	n_sym = 0;
+	syms_reset();
 
 	in_cnt = 0;
-	path = NULL;
+	path_len = 0;
+	path_mv = 0;
 	ps_error = 0;
 
 	s = strdup("/defl 0 def\n"
@@ -1420,31 +1864,101 @@ static void setg(int newg)
 }
 
 /* graphic path */
+static void path_out(char *fmt, va_list args)
+{
+	va_list args2;
+	int n;
+
+	if (!path) {
+		path_sz = 1024;
+		path = malloc(path_sz);
+		if (!path) {
+			fprintf(stderr, "Out of memory.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (;;) {
+		va_copy(args2, args);
+		n = vsnprintf(path + path_len, path_sz - path_len, fmt, args2);
+		va_end(args2);
+		if (n >= 0 && path_len + n < path_sz)
+			break;
+		path_sz *= 2;
+		if (n >= 0 && path_sz <= path_len + n)
+			path_sz = path_len + n + 1;
+		path = realloc(path, path_sz);
+		if (!path) {
+			fprintf(stderr, "Out of memory.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	path_len += n;
+}
+
+static void path_add(char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	path_out(fmt, args);
+	va_end(args);
+}
+
+/* output the pending relative move */
+static void path_flush(void)
+{
+	if (!path_mv)
+		return;
+	path_mv = 0;
+	path_add("\tm%.2f %.2f\n", path_mx, path_my);
+	path_op = 'm';
+}
+
 static void path_print(char *fmt, ...)
 {
 	va_list args;
-	char *p;
 
+	path_flush();
 	va_start(args, fmt);
-	vsnprintf(path_buf, sizeof path_buf, fmt, args);
+	path_out(fmt, args);
 	va_end(args);
-	if (!path) {
-		path = malloc(strlen(path_buf) + 1);
-		p = path;
-	} else {
-		path = realloc(path, strlen(path) + strlen(path_buf) + 1);
-		p = path + strlen(path);
+	path_op = 0;
+}
+
+/* relative line or move
+ * the consecutive moves are merged and the command letter
+ * is not repeated for the consecutive lines */
+static void path_rel(char op, float x, float y)
+{
+	if (op == 'm') {
+		if (path_mv) {
+			path_mx += x;
+			path_my += y;
+		} else {
+			path_mv = 1;
+			path_mx = x;
+			path_my = y;
+		}
+		return;
 	}
-	if (!path) {
-		fprintf(stderr, "Out of memory.\n");
-		exit(EXIT_FAILURE);
+	path_flush();
+	if (op == path_op) {
+		path[path_len - 1] = ' ';	/* replace the '\n' */
+		if (op == 'l')
+			path_add("%.2f %.2f\n", x, y);
+		else
+			path_add("%.2f\n", x);
+	} else if (op == 'l') {
+		path_add("\tl%.2f %.2f\n", x, y);
+	} else {
+		path_add("\t%c%.2f\n", op, x);
 	}
-	strcpy(p, path_buf);
+	path_op = op;
 }
 
 static void path_def(void)
 {
-	if (path)
+	if (path_len)
 		return;
 	setg(1);
 	path_print("<path d=\"m%.2f %.2f\n",
@@ -1454,16 +1968,17 @@ static void path_def(void)
 static void path_end(void)
 {
 	setg(1);
-	fputs(path, fout);
-	free(path);
-	path = NULL;
+	path_mv = 0;			/* a last move does nothing */
+	fwrite(path, 1, path_len, fout);
+	path_len = 0;
+	path_op = 0;
 }
 
 static void def_use(int def)
 {
 	int i;
 
-	ps_exec("dlw");
+	ps_exec(O_dlw);
 //	if (g == 2) {		-- may have other changes
 //		fputs("</text>\n", fout);
 //		g = 1;
@@ -1645,7 +2160,7 @@ static void stem(char *op)
 	struct ps_sym_s *sym;
 	float x, y, dx, h;
 
-	ps_exec("dlw");
+	ps_exec(O_dlw);
 
 	setg(1);
 	h = pop_free_val();
@@ -1665,69 +2180,283 @@ static void stem(char *op)
 		x, y, -h);
 }
 
-/*
- * types:
- *	s show / c showc / r showr / j jshow / b showb /x gxshow
- */
-static void show(char type)
+/* dt */
+static void dot(void)
 {
-	float x, y, w;
-	char tmp[4], *s, *p, *q;
-	int span;
+	struct ps_sym_s *sym;
+	float x, y;
 
-	span = 0;
-	gold.cx = gcur.cx;
-	gold.cy = gcur.cy;
-	if (memcmp(&gcur, &gold, sizeof gcur) != 0) {
-		if (g == 2)
-			span = 1;
-		else
-			defg1();
-	}
-	x = gcur.cx;
-	y = gcur.cy;
-	switch (type) {
-	case 'j':
-		w = pop_free_val();
-		p = tmp;
-		tmp[0] = '\0';
-		s = NULL;
+	setg(1);
+	sym = ps_sym_lookup("x");
+	x = gcur.xoffs + sym->e->u.v;
+	sym = ps_sym_lookup("y");
+	y = gcur.yoffs - sym->e->u.v;
+	y -= pop_free_val();
+	x += pop_free_val();
+	fprintf(fout,
+		"<circle class=\"fill\" cx=\"%.2f\" cy=\"%.2f\" r=\"1.2\"/>\n",
+		x, y);
+}
+
+/* bar thbar dotbar */
+static void bar(int op)
+{
+	float x, y, h;
+
+	setg(1);
+	y = gcur.yoffs - pop_free_val();
+	x = gcur.xoffs + pop_free_val();
+	h = pop_free_val();
+	switch (op) {
+	case DOP_bar:
+		fprintf(fout, "<path class=\"stroke\" stroke-width=\"1\"\n"
+			"	d=\"M%.2f %.2fv%.2f\"/>\n",
+			x, y, -h);
+		break;
+	case DOP_thbar:
+		fprintf(fout,
+			"<path class=\"stroke\" stroke-width=\"3\"\n"
+			"	d=\"M%.2f %.2fv%.2f\"/>\n",
+			x + 1.5, y, -h);
 		break;
 	default:
-		if (stack->type == STR) {
-			s = pop_free_str();
-			if (!s || s[0] != '(') {
-				fprintf(stderr, "svg: No string\n");
-				ps_error = 1;
-				return;
-			}
-			p = s + 1;			/* remove '(' */
-		} else {
-			p = tmp;
-			tmp[0] = pop_free_val();
-			tmp[1] = '\0';
-			s = NULL;
-		}
-		w = strw(p);
-		if (type == 'x') {		/* gxshow */
-			w = pop_free_val();	/* inter TAB width */
-			q = strchr(p, '\t');
-			*q = '\0';		/* string after the 1st one */
-		}
+		fprintf(fout,
+			"<path class=\"stroke\" stroke-dasharray=\"5,5\"\n"
+			"	d=\"M%.2f %.2fv%.2f\"/>\n",
+			x, y, -h);
 		break;
 	}
-	if (span) {
-		fprintf(fout, "<tspan\n\t");
-		output_font(1);
-		fprintf(fout, ">");
-	} else if (g != 2) {
-		fprintf(fout, "<text x=\"%.2f\" y=\"%.2f\"",
-				gcur.xoffs + x, gcur.yoffs - y);
-		switch (type) {
-		case 'c':
-			fprintf(fout, " text-anchor=\"middle\"");
-			w /= 2;
-			break;
+}
+
+/*
+ * direct SVG output
+ *
+ * The drawing functions put records instead of PostScript text
+ * for the most used operators. A record starts with REC and is:
+ *	'v' + 6 characters: value (IEEE float, 6 bits per character)
+ *	'o' + 1 character: operator ('0' + DOP_xxx)
+ * The values are rounded as in the PostScript text, so that
+ * the SVG output is the same.
+ */
+#define REC '\002'
+
+static char *rec_val(char *p, float v)
+{
+	union {
+		float v;
+		unsigned u;
+	} f;
+	int i;
+
+	f.v = (float) rint(v * 10.) / 10;
+	*p++ = REC;
+	*p++ = 'v';
+	for (i = 0; i < 6; i++) {
+		*p++ = '0' + (f.u & 0x3f);
+		f.u >>= 6;
+	}
+	return p;
+}
+
+static float rec_get(unsigned char *p)
+{
+	union {
+		float v;
+		unsigned u;
+	} f;
+	int i;
+
+	f.u = 0;
+	for (i = 6; --i >= 0; )
+		f.u = (f.u << 6) | (p[i] - '0');
+	return f.v;
+}
+
+static char *rec_op(char *p, int op)
+{
+	*p++ = REC;
+	*p++ = 'o';
+	*p++ = '0' + op;
+	return p;
+}
+
+static void svg_xy(float x, float y)
+{
+	char rec[16], *p;
+
+	p = rec_val(rec, x);
+	p = rec_val(p, y);
+	b_put(rec, p - rec);
+}
+
+static void svg_op(int op)
+{
+	char rec[3];
+
+	rec_op(rec, op);
+	b_put(rec, sizeof rec);
+}
+
+static void svg_sym(float x, float y, int op)
+{
+	char rec[24], *p;
+
+	p = rec_val(rec, x);
+	p = rec_val(p, y);
+	p = rec_op(p, op);
+	b_put(rec, p - rec);
+}
+
+static void svg_dot(float x, int y)
+{
+	char rec[24], *p;
+
+	p = rec_val(rec, x);
+	p = rec_val(p, y);
+	p = rec_op(p, DOP_dt);
+	b_put(rec, p - rec);
+}
+
+static void svg_stem(float h, int op)
+{
+	char rec[16], *p;
+
+	p = rec_val(rec, h);
+	p = rec_op(p, op);
+	b_put(rec, p - rec);
+}
+
+static void svg_bar(float h, float x, float y, int op)
+{
+	char rec[32], *p;
+
+	p = rec_val(rec, h);
+	p = rec_val(p, x);
+	p = rec_val(p, y);
+	p = rec_op(p, op);
+	b_put(rec, p - rec);
+}
+
+struct backend svg_be = {
+	svg_xy, svg_op, svg_sym, svg_dot, svg_stem, svg_bar
+};
+
+/* name indexes of the record operators */
+static const short dop_op[NDOP] = {
+	O_hd, O_Hd, O_HD, O_HDD, O_ghd,
+	O_breve, O_longa,
+	O_r128, O_r64, O_r32, O_r16, O_r8,
+	O_r4, O_r2, O_r1, O_r0, O_r00,
+	O_hl, O_hl1, O_hl2, O_ghl,
+	O_su, O_sd, O_gu, O_gd,
+	O_dt,
+	O_bar, O_thbar, O_dotbar,
+};
+
+/* execute an operator from a record */
+static void dop_exec(int op)
+{
+	static const unsigned char dop_def[NDOP] = {
+		D_hd, D_Hd, D_HD, D_HDD, D_ghd,
+		D_breve, D_longa,
+		D_r128, D_r64, D_r32, D_r16, D_r8,
+		D_r4, D_r2, D_r1, D_r0, D_r00,
+		D_hl, D_hl1, D_hl2, D_ghl,
+	};
+
+	if (ps_sym[dop_op[op]].e) {		/* PostScript redefinition */
+		ps_exec(dop_op[op]);
+		return;
+	}
+	switch (op) {
+	default:
+		if (op < DOP_hl)
+			setxysym(dop_tb[op], dop_def[op]);
+		else
+			xysym(dop_tb[op], dop_def[op]);
+		break;
+	case DOP_su:
+	case DOP_sd:
+	case DOP_gu:
+	case DOP_gd:
+		stem(dop_tb[op]);
+		break;
+	case DOP_dt:
+		dot();
+		break;
+	case DOP_bar:
+	case DOP_thbar:
+	case DOP_dotbar:
+		bar(op);
+		break;
+	}
+}
+
+/*
+ * types:
+ *	s show / c showc / r showr / j jshow / b showb /x gxshow
+ */
+static void show(char type)
+{
+	float x, y, w;
+	char tmp[4], *s, *p, *q;
+	int span;
+
+	span = 0;
+	gold.cx = gcur.cx;
+	gold.cy = gcur.cy;
+	if (memcmp(&gcur, &gold, sizeof gcur) != 0) {
+		if (g == 2)
+			span = 1;
+		else
+			defg1();
+	}
+	x = gcur.cx;
+	y = gcur.cy;
+	switch (type) {
+	case 'j':
+		w = pop_free_val();
+		p = tmp;
+		tmp[0] = '\0';
+		s = NULL;
+		break;
+	default:
+		if (stack->type == STR) {
+			s = pop_free_str();
+			if (!s || s[0] != '(') {
+				fprintf(stderr, "svg: No string\n");
+				ps_error = 1;
+				return;
+			}
+			p = s + 1;			/* remove '(' */
+		} else {
+			p = tmp;
+			tmp[0] = pop_free_val();
+			tmp[1] = '\0';
+			s = NULL;
+		}
+		w = strw(p);
+		if (type == 'x') {		/* gxshow */
+			w = pop_free_val();	/* inter TAB width */
+			s = str_w(s);
+			p = s + 1;
+			q = strchr(p, '\t');
+			*q = '\0';		/* string after the 1st one */
+		}
+		break;
+	}
+	if (span) {
+		fprintf(fout, "<tspan\n\t");
+		output_font(1);
+		fprintf(fout, ">");
+	} else if (g != 2) {
+		fprintf(fout, "<text x=\"%.2f\" y=\"%.2f\"",
+				gcur.xoffs + x, gcur.yoffs - y);
+		switch (type) {
+		case 'c':
+			fprintf(fout, " text-anchor=\"middle\"");
+			w /= 2;
+			break;
 		case 'r':
 			fprintf(fout, " text-anchor=\"end\"");
 			w = 0;
@@ -1773,7 +2502,52 @@ back:
 	}
 	gcur.cx = x + w;
 	if (s)
-		free(s);
+		str_free(s);
+}
+
+/* execute a compiled procedure
+ * returns 1 on 'exit' or error */
+static int code_exec(struct code_s *c, int n)
+{
+	struct elt_s *e;
+
+	for ( ; --n >= 0; c++) {
+		switch (c->type) {
+		case CD_VAL:
+			e = elt_new();
+			if (!e)
+				return 1;
+			e->u.v = c->u.v;
+			break;
+		case CD_OP:
+			if (c->nm == O_exit)
+				return 1;
+			ps_exec(c->nm);
+			continue;
+		default:
+			e = elt_ref(c->u.e);
+			if (!e)
+				return 1;
+			break;
+		}
+		push(e);
+	}
+	return 0;
+}
+
+static void op_exec(int n);
+
+/* execute a string element */
+static void str_exec(struct elt_s *e)
+{
+	if (e->nm) {
+		ps_exec(e->nm);
+		return;
+	}
+	if (e->u.s[0] == ' ')			/* load of a builtin operator */
+		op_exec(sym_get(e->u.s + 1));
+	else
+		ps_exec(sym_get(e->u.s));
 }
 
 /* execute a sequence
@@ -1786,9 +2560,9 @@ static int seq_exec(struct elt_s *e)
 	case STR:
 		if (e->u.s[0] != '/'
 		 && e->u.s[0] != '(') {
-			if (strcmp(e->u.s, "exit") == 0)
+			if (e->nm == O_exit)
 				return 1;
-			ps_exec(e->u.s);
+			str_exec(e);
 			return 0;
 		}
 		/* fall thru */
@@ -1805,10 +2579,10 @@ static int seq_exec(struct elt_s *e)
 	while (e) {
 		switch (e->type) {
 		case STR:
-			if (strcmp(e->u.s, "exit") == 0)
+			if (e->nm == O_exit)
 				return 1;
 			if (e->u.s[0] != '(' && e->u.s[0] != '/') {
-				ps_exec(e->u.s);
+				str_exec(e);
 				break;
 			}
 			/* fall thru */
@@ -1825,2502 +2599,2241 @@ static int seq_exec(struct elt_s *e)
 }
 
 /* execute a command */
-/* (in case of error, a string may be not freed, but this is not important!) */
-static void ps_exec(char *op)
+static void ps_exec(int n)
 {
 	struct ps_sym_s *sym;
-	struct elt_s *e, *e2;
-	float x, y, w, h;
-	int n;
-	char *s;
 
 	if (ps_error)
 		return;
 #if 0
-fprintf(stderr, "%s ", op);
+fprintf(stderr, "%s ", ps_sym[n].n);
 stack_dump();
 #endif
-	sym = ps_sym_lookup(op);
-	if (sym) {
-		if (++sym->exec > 2) {
-			fprintf(stderr, "svg: Too many recursions of '%s'\n",
-				op);
-			ps_error = 1;
-			return;
-		}
-		seq_exec(sym->e);
-		sym->exec--;
+	sym = &ps_sym[n];
+	if (!sym->e) {
+		op_exec(n);
+		return;
+	}
+	if (sym->exec >= 2) {
+		fprintf(stderr, "svg: Too many recursions of '%s'\n",
+			sym->n);
+		ps_error = 1;
 		return;
 	}
+	sym->exec++;
+	if (sym->ncode)
+		code_exec(sym->code, sym->ncode);
+	else
+		seq_exec(sym->e);
+	if (--sym->exec == 0 && sym->old)
+		code_old_free(sym);
+}
 
-	if (*op == ' ')				/* load */
-		op++;
+/* execute a builtin operator */
+/* (in case of error, a string may be not freed, but this is not important!) */
+static void op_exec(int opc)
+{
+	struct ps_sym_s *sym;
+	struct elt_s *e, *e2;
+	float x, y, w, h;
+	int n;
+	char *s, *op;
 
-	switch (*op) {
-	case '!':				/* def */
-		if (op[1] == '\0') {
-			if (!stack) {
-				fprintf(stderr, "svg def: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = pop(stack->type);	/* value */
-			s = pop_free_str();	/* symbol */
-			if (!s || *s != '/') {
-				fprintf(stderr, "svg def: No / bad symbol\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			ps_sym_def(&s[1], e);
-			free(s);
+	if (ps_error)
+		return;
+	op = ps_sym[opc].n;
+	switch (opc) {
+	case O_store:			/* def */
+		if (!stack) {
+			fprintf(stderr, "svg def: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'a':
-		if (strcmp(op, "accent") == 0) {
-			xysym(op, D_accent);
+		e = pop(stack->type);	/* value */
+		s = pop_free_str();	/* symbol */
+		if (!s || *s != '/') {
+			fprintf(stderr, "svg def: No / bad symbol\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "abs") == 0) {
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg abs: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			if (stack->u.v < 0)
-				stack->u.v = -stack->u.v;
+		ps_sym_def(&s[1], e);
+		str_free(s);
+		return;
+	case O_accent:
+		xysym(op, D_accent);
+		return;
+	case O_abs:
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg abs: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "add") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg add: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v += x;
+		if (stack->u.v < 0)
+			stack->u.v = -stack->u.v;
+		return;
+	case O_add:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg add: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "and") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg and: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v = (int) x & (int) stack->u.v;
+		stack->u.v += x;
+		return;
+	case O_and:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg and: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "anshow") == 0) {
-			show('s');
+		stack->u.v = (int) x & (int) stack->u.v;
+		return;
+	case O_anshow:
+		show('s');
+		return;
+	case O_arc:
+	case O_arcn: {
+		float r, a1, a2, x1, y1, x2, y2;
+
+		a2 = pop_free_val();
+		a1 = pop_free_val();
+		r = pop_free_val();
+		if (r < 0) {
+			fprintf(stderr, "svg arc: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "arc") == 0
-		 || strcmp(op, "arcn") == 0) {
-			float r, a1, a2, x1, y1, x2, y2;
-
-			a2 = pop_free_val();
-			a1 = pop_free_val();
-			r = pop_free_val();
-			if (r < 0) {
-				fprintf(stderr, "svg arc: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			if (a1 >= 360)
-				a1 -= 360;
-			if (a2 >= 360)
-				a2 -= 360;
-			y = pop_free_val();
-			x = pop_free_val();
-			x1 = x + r * cos(a1 * M_PI / 180);
-			y1 = y + r * sinf(a1 * M_PI / 180);
-			if (gcur.cx != NaN) {		// if no newpath
-				if (path) {
-					path_print("\n\t%c%.2f %.2f",
-						x1 != gcur.cx || y1 != gcur.cy ? 'l'
-										: 'm',
-						x1 - gcur.cx, -(y1 - gcur.cy));
-				} else {
-					gcur.cx = x1;
-					gcur.cy = y1;
-					path_def();
-				}
+		if (a1 >= 360)
+			a1 -= 360;
+		if (a2 >= 360)
+			a2 -= 360;
+		y = pop_free_val();
+		x = pop_free_val();
+		x1 = x + r * cos(a1 * M_PI / 180);
+		y1 = y + r * sinf(a1 * M_PI / 180);
+		if (gcur.cx != NaN) {		// if no newpath
+			if (path_len) {
+				path_print("\n\t%c%.2f %.2f",
+					x1 != gcur.cx || y1 != gcur.cy ? 'l'
+									: 'm',
+					x1 - gcur.cx, -(y1 - gcur.cy));
 			} else {
 				gcur.cx = x1;
 				gcur.cy = y1;
 				path_def();
 			}
-			if (a1 == a2) {			/* circle */
-				a2 = 180 - a1;
-				x2 = x + r * cosf(a2 * M_PI / 180);
-				y2 = y + r * sinf(a2 * M_PI / 180);
-				path_print("\n\ta%.2f %.2f 0 0 %d %.2f %.2f "
-					"%.2f %.2f 0 0 %d %.2f %.2f\n",
-					r, r, op[3] == 'n', x2 - x1, -(y2 - y1),
-					r, r, op[3] == 'n', x1 - x2, -(y1 - y2));
-				gcur.cx = x1;
-				gcur.cy = y1;
-			} else {
-				x2 = x + r * cosf(a2 * M_PI / 180);
-				y2 = y + r * sinf(a2 * M_PI / 180);
-				path_print("\n\ta%.2f %.2f 0 0 %d %.2f %.2f\n",
-					r, r, op[3] == 'n', x2 - x1, -(y2 - y1));
-				gcur.cx = x2;
-				gcur.cy = y2;
-			}
-			return;
-		}
-		if (strcmp(op, "arp") == 0) {
-			arp_ltr('a');
-			return;
-		}
-		if (strcmp(op, "atan") == 0) {
-			x = pop_free_val();	/* den */
-			if (!stack || stack->type != VAL || x == 0) {
-				fprintf(stderr, "svg atan: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			y = stack->u.v;		/* num */
-			stack->u.v = atan(y / x) / M_PI * 180;
-			return;
-		}
-		break;
-	case 'b':
-		if (strcmp(op, "bar") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			h = pop_free_val();
-			fprintf(fout, "<path class=\"stroke\" stroke-width=\"1\"\n"
-				"	d=\"M%.2f %.2fv%.2f\"/>\n",
-				x, y, -h);
-			return;
+		} else {
+			gcur.cx = x1;
+			gcur.cy = y1;
+			path_def();
 		}
-		if (strcmp(op, "bclef") == 0) {
-			xysym(op, D_bclef);
-			return;
+		if (a1 == a2) {			/* circle */
+			a2 = 180 - a1;
+			x2 = x + r * cosf(a2 * M_PI / 180);
+			y2 = y + r * sinf(a2 * M_PI / 180);
+			path_print("\n\ta%.2f %.2f 0 0 %d %.2f %.2f "
+				"%.2f %.2f 0 0 %d %.2f %.2f\n",
+				r, r, op[3] == 'n', x2 - x1, -(y2 - y1),
+				r, r, op[3] == 'n', x1 - x2, -(y1 - y2));
+			gcur.cx = x1;
+			gcur.cy = y1;
+		} else {
+			x2 = x + r * cosf(a2 * M_PI / 180);
+			y2 = y + r * sinf(a2 * M_PI / 180);
+			path_print("\n\ta%.2f %.2f 0 0 %d %.2f %.2f\n",
+				r, r, op[3] == 'n', x2 - x1, -(y2 - y1));
+			gcur.cx = x2;
+			gcur.cy = y2;
 		}
-		if (strcmp(op, "bdef") == 0) {
-			ps_exec("!");
+		return;
+	    }
+	case O_arp:
+		arp_ltr('a');
+		return;
+	case O_atan:
+		x = pop_free_val();	/* den */
+		if (!stack || stack->type != VAL || x == 0) {
+			fprintf(stderr, "svg atan: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "bind") == 0) {
+		y = stack->u.v;		/* num */
+		stack->u.v = atan(y / x) / M_PI * 180;
+		return;
+	case O_bar:
+		bar(DOP_bar);
+		return;
+	case O_bclef:
+		xysym(op, D_bclef);
+		return;
+	case O_bdef:
+		ps_exec(O_store);
+		return;
+	case O_bind:
+		return;
+	case O_bitshift: {
+		int shift;
+
+		shift = pop_free_val();
+		if (!stack || stack->type != VAL
+		 || shift >= 32  || shift < -32) {
+			fprintf(stderr, "svg: Bad value for bitshift\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "bitshift") == 0) {
-			int shift;
+		if (shift > 0)
+			n = (int) stack->u.v << shift;
+		else
+			n = (int) stack->u.v >> -shift;
+		stack->u.v = n;
+		return;
+	    }
+	case O_bm: {
+		float dx, dy;
 
-			shift = pop_free_val();
-			if (!stack || stack->type != VAL
-			 || shift >= 32  || shift < -32) {
-				fprintf(stderr, "svg: Bad value for bitshift\n");
-				ps_error = 1;
-				return;
-			}
-			if (shift > 0)
-				n = (int) stack->u.v << shift;
-			else
-				n = (int) stack->u.v >> -shift;
-			stack->u.v = n;
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		dy = pop_free_val();
+		dx = pop_free_val();
+		h = pop_free_val();
+		fprintf(fout,
+			"<path class=\"fill\"\n"
+			"	d=\"M%.2f %.2fl%.2f %.2fv%.2fl%.2f %.2f\"/>\n",
+			x, y, dx, -dy, h,-dx, dy);
+		return;
+	    }
+	case O_bnum:
+	case O_bnumb:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "bm") == 0) {
-			float dx, dy;
-
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			dy = pop_free_val();
-			dx = pop_free_val();
-			h = pop_free_val();
+		if (op[4] == 'b') {
+			w = 7 * strlen(s);
 			fprintf(fout,
-				"<path class=\"fill\"\n"
-				"	d=\"M%.2f %.2fl%.2f %.2fv%.2fl%.2f %.2f\"/>\n",
-				x, y, dx, -dy, h,-dx, dy);
+				"<rect x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"12\" fill=\"white\"/>\n",
+				x - w / 2, y - 10, w);
+		}
+		fprintf(fout,
+			"<text style=\"font:italic 12px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
+			x, y, s + 1);
+		str_free(s);
+		return;
+	case O_box:
+		setg(1);
+		h = pop_free_val();
+		w = pop_free_val();
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		fprintf(fout,
+			"<rect class=\"stroke\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
+			x, y - h, w, h);
+		return;
+	case O_boxdraw:
+		setg(1);
+		h = pop_free_val();
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		fprintf(fout,
+			"<rect class=\"stroke\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
+			x, y - h, boxend - (x - gcur.xoffs) + 2, h);
+		return;
+	case O_boxmark:
+		if (gcur.cx > boxend)
+			boxend = gcur.cx;
+		return;
+	case O_boxend:
+		boxend = gcur.cx;
+		return;
+	case O_brace:
+		def_use(D_brace);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		h = pop_free_val() * 0.01;
+		fprintf(fout,
+			"<g transform=\"translate(%.2f,%.2f) scale(1,%.2f)\">\n"
+			"	<use xlink:href=\"#brace\"/>\n"
+			"</g>\n",
+			x, y, h);
+		return;
+	case O_bracket:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 3;
+		x = gcur.xoffs + pop_free_val() - 5;
+		h = pop_free_val() + 2;
+		fprintf(fout,
+			"<path class=\"fill\"\n"
+			"	d=\"M%.2f %.2f\n"
+			"	c10.5 1 12 -4.5 12 -3.5c0 1 -3.5 5.5 -8.5 5.5\n"
+			"	v%.2f\n"
+			"	c5 0 8.5 4.5 8.5 5.5c0 1 -1.5 -4.5 -12 -3.5\"/>\n",
+			x, y, h);
+		return;
+	case O_breve:
+		setxysym(op, D_breve);
+		return;
+	case O_brth:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 6;
+		x = gcur.xoffs + pop_free_val();
+		fprintf(fout, "<text x=\"%.2f\" y=\"%.2f\""
+				" style=\"font:bold italic 30px serif\">"
+				",</text>\n",
+			x, y);
+		return;
+	case O_C: {
+		float c1, c2, c3, c4;
+
+curveto:
+		path_def();
+		y = pop_free_val();
+		x = pop_free_val();
+		c4 = gcur.yoffs - pop_free_val();
+		c3 = gcur.xoffs + pop_free_val();
+		c2 = gcur.yoffs - pop_free_val();
+		c1 = gcur.xoffs + pop_free_val();
+		path_print("\tC%.2f %.2f %.2f %.2f %.2f %.2f\n",
+			c1, c2, c3, c4, gcur.xoffs + x, gcur.yoffs - y);
+		gcur.cx = x;
+		gcur.cy = y;
+		return;
+	    }
+	case O_cclef:
+		xysym(op, D_cclef);
+		return;
+	case O_csig:
+		xysym(op, D_csig);
+		return;
+	case O_ctsig:
+		xysym(op, D_ctsig);
+		return;
+	case O_coda:
+		xysym(op, D_coda);
+		return;
+	case O_closepath:
+		if (path_len) {
+//				path_def();
+			path_print("\tz");
+		}
+		return;
+	case O_composefont:
+		pop(BRK);
+		pop(STR);
+		return;
+	case O_copy: {
+		struct elt_s *e3;
+
+		n = pop_free_val();
+		if ((unsigned) n > 10) {
+			fprintf(stderr, "svg copy: Too wide\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "bnum") == 0
-		 || strcmp(op, "bnumb") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg: No string\n");
-				ps_error = 1;
+		e = stack;
+		e2 = NULL;
+		while (--n >= 0) {
+			if (!e)
+				break;
+			e3 = elt_dup(e);
+			if (!e3)
 				return;
-			}
-			if (op[4] == 'b') {
-				w = 7 * strlen(s);
-				fprintf(fout,
-					"<rect x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"12\" fill=\"white\"/>\n",
-					x - w / 2, y - 10, w);
-			}
-			fprintf(fout,
-				"<text style=\"font:italic 12px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
-			return;
+			e3->next = e2;
+			e2 = e3;
+			e = e->next;
 		}
-		if (strcmp(op, "box") == 0) {
-			setg(1);
-			h = pop_free_val();
-			w = pop_free_val();
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			fprintf(fout,
-				"<rect class=\"stroke\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
-				x, y - h, w, h);
+		if (n >= 0) {
+			fprintf(stderr, "svg copy: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "boxdraw") == 0) {
-			setg(1);
-			h = pop_free_val();
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			fprintf(fout,
-				"<rect class=\"stroke\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
-				x, y - h, boxend - (x - gcur.xoffs) + 2, h);
-			return;
+		while (e2) {
+			e3 = e2->next;
+			push(e2);
+			e2 = e3;
 		}
-		if (strcmp(op, "boxmark") == 0) {
-			if (gcur.cx > boxend)
-				boxend = gcur.cx;
+		return;
+	    }
+	case O_cos:
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg cos: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "boxend") == 0) {
-			boxend = gcur.cx;
+		stack->u.v = cos(stack->u.v * M_PI / 180);
+		return;
+	case O_cpu:
+		xysym(op, D_cpu);
+		return;
+	case O_crdc:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg crdc: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "brace") == 0) {
-			def_use(D_brace);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			h = pop_free_val() * 0.01;
-			fprintf(fout,
-				"<g transform=\"translate(%.2f,%.2f) scale(1,%.2f)\">\n"
-				"	<use xlink:href=\"#brace\"/>\n"
-				"</g>\n",
-				x, y, h);
+		fprintf(fout, "<text style=\"font:italic 16px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"left\">%s</text>\n",
+			x, y, s + 1);
+		str_free(s);
+		return;
+	case O_cresc:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		sym = ps_sym_lookup("defl");
+		x += w;
+		if ((int) sym->e->u.v & 1)
+			fprintf(fout, "<path class=\"stroke\"\n"
+				"d=\"M%.2f %.2fl%.2f -2.2m0 -3.6l%.2f -2.2\"/>\n",
+				x, y, -w, w);
+		else
+			fprintf(fout, "<path class=\"stroke\"\n"
+				"d=\"M%.2f %.2fl%.2f -4l%.2f -4\"/>\n",
+				x, y, -w, w);
+		return;
+	case O_custos:
+		xysym(op, D_custos);
+		return;
+	case O_currentgray:
+		e = elt_new();
+		if (!e)
+			return;
+		e->type = VAL;
+		e->u.v = (float) gcur.rgb / 0xffffff;
+		push(e);
+		return;
+	case O_currentpoint:
+		e = elt_new();
+		if (!e)
+			return;
+		e->type = VAL;
+		e->u.v = gcur.cx;
+		push(e);
+		e = elt_new();
+		if (!e)
+			return;
+		e->type = VAL;
+		e->u.v = gcur.cy;
+		push(e);
+		return;
+	case O_curveto:
+		goto curveto;
+	case O_cvi:
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg cvi: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "bracket") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 3;
-			x = gcur.xoffs + pop_free_val() - 5;
-			h = pop_free_val() + 2;
-			fprintf(fout,
-				"<path class=\"fill\"\n"
-				"	d=\"M%.2f %.2f\n"
-				"	c10.5 1 12 -4.5 12 -3.5c0 1 -3.5 5.5 -8.5 5.5\n"
-				"	v%.2f\n"
-				"	c5 0 8.5 4.5 8.5 5.5c0 1 -1.5 -4.5 -12 -3.5\"/>\n",
-				x, y, h);
+		n = stack->u.v;
+		stack->u.v = n;
+		return;
+	case O_cvx:
+		s = pop_free_str();
+		if (!s || ((*s != '/') && (*s != '('))) {
+			fprintf(stderr, "svg cvx: No / bad string\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "breve") == 0) {
-			setxysym(op, D_breve);
+		s = str_w(s);
+		*s = '{';
+		svg_write(s, strlen(s));
+		svg_write("}", 1);
+		str_free(s);
+		return;
+	case O_dacs:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 3;
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg dacs: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "brth") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 6;
-			x = gcur.xoffs + pop_free_val();
-			fprintf(fout, "<text x=\"%.2f\" y=\"%.2f\""
-					" style=\"font:bold italic 30px serif\">"
-					",</text>\n",
-				x, y);
+		fprintf(fout, "<text style=\"font:16px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
+			x, y, s + 1);
+		str_free(s);
+		return;
+	case O_def:
+		ps_exec(O_store);
+		return;
+	case O_dim:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		sym = ps_sym_lookup("defl");
+		if ((int) sym->e->u.v & 2)
+			fprintf(fout, "<path class=\"stroke\"\n"
+				"d=\"M%.2f %.2fl%.2f -2.2m0 -3.6l%.2f -2.2\"/>\n",
+				x, y, w, -w);
+		else
+			fprintf(fout, "<path class=\"stroke\"\n"
+				"d=\"M%.2f %.2fl%.2f -4l%.2f -4\"/>\n",
+				x, y, w, -w);
+		return;
+	case O_div:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL || x == 0) {
+			fprintf(stderr, "svg: Bad value for div\n");
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'C':
-		if (strcmp(op, "C") == 0) {
-			float c1, c2, c3, c4;
+		stack->u.v /= x;
+		return;
+	case O_dnb:
+		xysym(op, D_dnb);
+		return;
+	case O_dplus:
+		xysym(op, D_dplus);
+		return;
+	case O_dSL: {
+		float a1, a2, a3, a4, a5, a6, m1, m2;
 
-curveto:
-			path_def();
-			y = pop_free_val();
-			x = pop_free_val();
-			c4 = gcur.yoffs - pop_free_val();
-			c3 = gcur.xoffs + pop_free_val();
-			c2 = gcur.yoffs - pop_free_val();
-			c1 = gcur.xoffs + pop_free_val();
-			path_print("\tC%.2f %.2f %.2f %.2f %.2f %.2f\n",
-				c1, c2, c3, c4, gcur.xoffs + x, gcur.yoffs - y);
-			gcur.cx = x;
-			gcur.cy = y;
+		setg(1);
+		m2 = gcur.yoffs - pop_free_val();
+		m1 = gcur.xoffs + pop_free_val();
+		a6 = pop_free_val();
+		a5 = pop_free_val();
+		a4 = pop_free_val();
+		a3 = pop_free_val();
+		a2 = pop_free_val();
+		a1 = pop_free_val();
+		fprintf(fout,
+			"<path class=\"stroke\" stroke-dasharray=\"5,5\"\n"
+			"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
+				m1, m2, a1, -a2, a3, -a4, a5, -a6);
+		return;
+	    }
+	case O_dt:
+		dot();
+		return;
+	case O_dotbar:
+		bar(DOP_dotbar);
+		return;
+	case O_dup:
+		if (!stack) {
+			fprintf(stderr, "svg dup: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'c':
-		if (strcmp(op, "cclef") == 0) {
-			xysym(op, D_cclef);
+		e = elt_dup(stack);
+		if (e)
+			push(e);
+		return;
+	case O_dft0:
+		xysym(op, D_dft0);
+		return;
+	case O_dsh0:
+		xysym(op, D_dsh0);
+		return;
+	case O_emb:
+		xysym(op, D_emb);
+		return;
+	case O_eofill:
+		if (!path_len) {
+			fprintf(stderr, "svg eofill: No path\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "csig") == 0) {
-			xysym(op, D_csig);
+		path_end();
+		fprintf(fout, "\t\" fill-rule=\"evenodd\" class=\"fill\"/>\n");
+		return;
+	case O_eq:
+		cond(C_EQ);
+		return;
+	case O_exch:
+		if (!stack || !stack->next) {
+			fprintf(stderr, "svg exch: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "ctsig") == 0) {
-			xysym(op, D_ctsig);
+		e = stack->next;
+		stack->next = e->next;
+		e->next = stack;
+		stack = e;
+		return;
+	case O_exec:
+		e = pop(SEQ);
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "coda") == 0) {
-			xysym(op, D_coda);
+		seq_exec(e);
+		elt_free(e);
+		return;
+	case O_false:
+		e = elt_new();
+		if (!e)
+			return;
+		e->type = VAL;
+		e->u.v = 0;
+		push(e);
+		return;
+	case O_fill:
+		if (!path_len) {
+			fprintf(stderr, "svg fill: No path\n");
+//				ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "closepath") == 0) {
-			if (path) {
-//				path_def();
-				path_print("\tz");
-			}
+		path_end();
+		fprintf(fout, "\t\" class=\"fill\"/>\n");
+		return;
+	case O_findfont:
+		s = pop_free_str();
+		if (!s
+		 || *s != '/') {
+			fprintf(stderr, "svg findfont: No / bad font\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "composefont") == 0) {
-			pop(BRK);
-			pop(STR);
+		if (strcmp(s, gcur.font_n) != 0) {
+			free(gcur.font_n_old);
+			gcur.font_n_old = gcur.font_n;
+			gcur.font_n = strdup(s);
+		}
+		str_free(s);
+		return;
+	case O_fng:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 1;
+		x = gcur.xoffs + pop_free_val() - 3;
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg fng: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "copy") == 0) {
-			struct elt_s *e3;
+		fprintf(fout, "<text style=\"font:8px Bookman\"\n"
+			"	x=\"%.2f\" y=\"%.2f\">%s</text>\n",
+			x, y, s + 1);
+		str_free(s);
+		return;
+	case O_for: {
+		float init, incr, limit;
 
-			n = pop_free_val();
-			if ((unsigned) n > 10) {
-				fprintf(stderr, "svg copy: Too wide\n");
-				ps_error = 1;
-				return;
-			}
-			e = stack;
-			e2 = NULL;
-			while (--n >= 0) {
-				if (!e)
+		e = pop(SEQ);			/* proc */
+		if (!e)
+			return;
+		limit = pop_free_val();
+		incr = pop_free_val();
+		init = pop_free_val();
+		if (incr == 0
+		 || (limit - init) / incr > 100) {
+			fprintf(stderr, "svg for: Bad values\n");
+			ps_error = 1;
+			return;
+		}
+		if (incr > 0) {
+			while (init <= limit) {
+				e2 = elt_new();
+				if (!e2)
 					break;
-				e3 = elt_dup(e);
-				if (!e3)
-					return;
-				e3->next = e2;
-				e2 = e3;
-				e = e->next;
-			}
-			if (n >= 0) {
-				fprintf(stderr, "svg copy: Stack empty\n");
-				ps_error = 1;
-				return;
+				e2->type = VAL;
+				e2->u.v = init;
+				push(e2);
+				if (seq_exec(e) != 0)
+					break;
+				init += incr;
 			}
-			while (e2) {
-				e3 = e2->next;
+		} else {
+			while (init >= limit) {
+				e2 = elt_new();
+				if (!e2)
+					break;
+				e2->type = VAL;
+				e2->u.v = init;
 				push(e2);
-				e2 = e3;
+				if (seq_exec(e) != 0)
+					break;
+				init += incr;
 			}
-			return;
 		}
-		if (strcmp(op, "cos") == 0) {
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg cos: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v = cos(stack->u.v * M_PI / 180);
+		elt_free(e);
+		return;
+	    }
+	case O_forall: {
+		struct elt_s *e3;
+		unsigned char *p;
+
+		e = pop(SEQ);			/* proc */
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "cpu") == 0) {
-			xysym(op, D_cpu);
+		e2 = stack;			/* array/string */
+		if (!e2) {
+			fprintf(stderr, "svg forall: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "crdc") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg crdc: No string\n");
-				ps_error = 1;
-				return;
+		stack = e2->next;
+		switch (e2->type) {
+		case STR:
+			p = (unsigned char *) &e2->u.s[1];
+			while (*p != '\0') {
+				e3 = elt_new();
+				if (!e3)
+					return;
+				e3->u.v = *p++;
+				push(e3);
+				if (seq_exec(e) != 0)
+					break;
 			}
-			fprintf(fout, "<text style=\"font:italic 16px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"left\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "cresc") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			sym = ps_sym_lookup("defl");
-			x += w;
-			if ((int) sym->e->u.v & 1)
-				fprintf(fout, "<path class=\"stroke\"\n"
-					"d=\"M%.2f %.2fl%.2f -2.2m0 -3.6l%.2f -2.2\"/>\n",
-					x, y, -w, w);
-			else
-				fprintf(fout, "<path class=\"stroke\"\n"
-					"d=\"M%.2f %.2fl%.2f -4l%.2f -4\"/>\n",
-					x, y, -w, w);
-			return;
-		}
-		if (strcmp(op, "custos") == 0) {
-			xysym(op, D_custos);
+			break;
+		case BRK:
+			for (e3 = e2->u.e; e3; e3 = e3->next) {
+				struct elt_s *e4;
+
+				e4 = elt_dup(e3);
+				push(e4);
+				if (seq_exec(e) != 0)
+					break;
+			}
+			break;
+		default:
+			fprintf(stderr, "svg forall: Bad any\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "currentgray") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = (float) gcur.rgb / 0xffffff;
-			push(e);
-			return;
+		elt_free(e);
+		elt_free(e2);
+		return;
+	    }
+	case O_ft0:
+		xysym(op, D_ft0);
+		return;
+	case O_ft1:
+		xysym(op, D_ft1);
+		return;
+	case O_ft4:
+		n = pop_free_val();
+		switch (n) {
+		case 1:
+			xysym("ft1", D_ft1);
+			break;
+		case 2:
+			xysym("ft0", D_ft0);
+			break;
+		case 3:
+			xysym("ft513", D_ft513);
+			break;
+		default:
+			xysym("dft0", D_dft0);
+			break;
 		}
-		if (strcmp(op, "currentpoint") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = gcur.cx;
-			push(e);
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = gcur.cy;
-			push(e);
+		return;
+	case O_ft513:
+		xysym(op, D_ft513);
+		return;
+	case O_gcshow:
+		show('s');
+		return;
+	case O_ge:
+		cond(C_GE);
+		return;
+	case O_get:
+		n = pop_free_val();
+		if (!stack) {
+			fprintf(stderr, "svg get: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "curveto") == 0)
-			goto curveto;
-		if (strcmp(op, "cvi") == 0) {
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg cvi: Bad value\n");
+		switch (stack->type) {
+		case VAL:
+			if (n != 0) {
+				fprintf(stderr, "svg get: Out of bounds\n");
 				ps_error = 1;
 				return;
 			}
-			n = stack->u.v;
-			stack->u.v = n;
 			return;
-		}
-		if (strcmp(op, "cvx") == 0) {
-			s = pop_free_str();
-			if (!s || ((*s != '/') && (*s != '('))) {
-				fprintf(stderr, "svg cvx: No / bad string\n");
+		case STR:
+			s = stack->u.s;
+			if (!s || *s != '(') {
+				fprintf(stderr, "svg get: Not a string\n");
 				if (s)
-					free(s);
+					str_free(s);
 				ps_error = 1;
 				return;
 			}
-			*s = '{';
-			svg_write(s, strlen(s));
-			svg_write("}", 1);
-			free(s);
-			return;
-		}
-		break;
-	case 'd':
-		if (strcmp(op, "dacs") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 3;
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg dacs: No string\n");
+			if ((unsigned) n >= strlen(s) - 1) {
+				fprintf(stderr, "svg get: Out of bounds\n");
 				ps_error = 1;
 				return;
 			}
-			fprintf(fout, "<text style=\"font:16px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "def") == 0) {
-			ps_exec("!");
+			stack->type = VAL;
+			stack->u.v = s[n + 1];
+			str_free(s);
 			return;
 		}
-		if (strcmp(op, "dim") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			sym = ps_sym_lookup("defl");
-			if ((int) sym->e->u.v & 2)
-				fprintf(fout, "<path class=\"stroke\"\n"
-					"d=\"M%.2f %.2fl%.2f -2.2m0 -3.6l%.2f -2.2\"/>\n",
-					x, y, w, -w);
-			else
-				fprintf(fout, "<path class=\"stroke\"\n"
-					"d=\"M%.2f %.2fl%.2f -4l%.2f -4\"/>\n",
-					x, y, w, -w);
-			return;
-		}
-		if (strcmp(op, "div") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL || x == 0) {
-				fprintf(stderr, "svg: Bad value for div\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v /= x;
-			return;
-		}
-		if (strcmp(op, "dnb") == 0) {
-			xysym(op, D_dnb);
-			return;
-		}
-		if (strcmp(op, "dplus") == 0) {
-			xysym(op, D_dplus);
-			return;
-		}
-		if (strcmp(op, "dSL") == 0) {
-			float a1, a2, a3, a4, a5, a6, m1, m2;
-
-			setg(1);
-			m2 = gcur.yoffs - pop_free_val();
-			m1 = gcur.xoffs + pop_free_val();
-			a6 = pop_free_val();
-			a5 = pop_free_val();
-			a4 = pop_free_val();
-			a3 = pop_free_val();
-			a2 = pop_free_val();
-			a1 = pop_free_val();
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-dasharray=\"5,5\"\n"
-				"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
-					m1, m2, a1, -a2, a3, -a4, a5, -a6);
-			return;
-		}
-		if (strcmp(op, "dt") == 0) {
-			setg(1);
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
-			y -= pop_free_val();
-			x += pop_free_val();
-			fprintf(fout,
-				"<circle class=\"fill\" cx=\"%.2f\" cy=\"%.2f\" r=\"1.2\"/>\n",
-				x, y);
-			return;
-		}
-		if (strcmp(op, "dotbar") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			h = pop_free_val();
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-dasharray=\"5,5\"\n"
-				"	d=\"M%.2f %.2fv%.2f\"/>\n",
-				x, y, -h);
-			return;
-		}
-		if (strcmp(op, "dup") == 0) {
-			if (!stack) {
-				fprintf(stderr, "svg dup: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = elt_dup(stack);
-			if (e)
-				push(e);
-			return;
-		}
-		if (strcmp(op, "dft0") == 0) {
-			xysym(op, D_dft0);
-			return;
-		}
-		if (strcmp(op, "dsh0") == 0) {
-			xysym(op, D_dsh0);
-			return;
-		}
-		break;
-	case 'e':
-		if (strcmp(op, "emb") == 0) {
-			xysym(op, D_emb);
-			return;
-		}
-		if (strcmp(op, "eofill") == 0) {
-			if (!path) {
-				fprintf(stderr, "svg eofill: No path\n");
-				ps_error = 1;
-				return;
-			}
-			path_end();
-			fprintf(fout, "\t\" fill-rule=\"evenodd\" class=\"fill\"/>\n");
-			return;
-		}
-		if (strcmp(op, "eq") == 0) {
-			cond(C_EQ);
-			return;
-		}
-		if (strcmp(op, "exch") == 0) {
-			if (!stack || !stack->next) {
-				fprintf(stderr, "svg exch: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = stack->next;
-			stack->next = e->next;
-			e->next = stack;
-			stack = e;
-			return;
-		}
-		if (strcmp(op, "exec") == 0) {
-			e = pop(SEQ);
-			if (!e)
-				return;
-			seq_exec(e);
-			elt_free(e);
-			return;
-		}
-		break;
-	case 'F':
-		if (sscanf(op, "F%d", &n) == 1) {
-			h = pop_free_val();
-			if (gcur.font_s != h
-			 || strcmp(fontnames[n], gcur.font_n) != 0) {
-				free(gcur.font_n_old);
-				gcur.font_n_old = gcur.font_n;
-				gcur.font_n = strdup(fontnames[n]);
-				gcur.font_s = h;
-			}
-			return;
-		}
-		break;
-	case 'f':
-		if (strcmp(op, "false") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = 0;
-			push(e);
-			return;
-		}
-		if (strcmp(op, "fill") == 0) {
-			if (!path) {
-				fprintf(stderr, "svg fill: No path\n");
-//				ps_error = 1;
-				return;
-			}
-			path_end();
-			fprintf(fout, "\t\" class=\"fill\"/>\n");
-			return;
-		}
-		if (strcmp(op, "findfont") == 0) {
-			s = pop_free_str();
-			if (!s
-			 || *s != '/') {
-				fprintf(stderr, "svg findfont: No / bad font\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			if (strcmp(s, gcur.font_n) != 0) {
-				free(gcur.font_n_old);
-				gcur.font_n_old = gcur.font_n;
-				gcur.font_n = s;
-			} else {
-				free(s);
-			}
-			return;
-		}
-		if (strcmp(op, "fng") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 1;
-			x = gcur.xoffs + pop_free_val() - 3;
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg fng: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<text style=\"font:8px Bookman\"\n"
-				"	x=\"%.2f\" y=\"%.2f\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "for") == 0) {
-			float init, incr, limit;
-
-			e = pop(SEQ);			/* proc */
-			if (!e)
-				return;
-			limit = pop_free_val();
-			incr = pop_free_val();
-			init = pop_free_val();
-			if (incr == 0
-			 || (limit - init) / incr > 100) {
-				fprintf(stderr, "svg for: Bad values\n");
-				ps_error = 1;
-				return;
-			}
-			if (incr > 0) {
-				while (init <= limit) {
-					e2 = elt_new();
-					if (!e2)
-						break;
-					e2->type = VAL;
-					e2->u.v = init;
-					push(e2);
-					if (seq_exec(e) != 0)
-						break;
-					init += incr;
-				}
-			} else {
-				while (init >= limit) {
-					e2 = elt_new();
-					if (!e2)
-						break;
-					e2->type = VAL;
-					e2->u.v = init;
-					push(e2);
-					if (seq_exec(e) != 0)
-						break;
-					init += incr;
-				}
-			}
-			elt_free(e);
-			return;
-		}
-		if (strcmp(op, "forall") == 0) {
-			struct elt_s *e3;
-			unsigned char *p;
-
-			e = pop(SEQ);			/* proc */
-			if (!e)
-				return;
-			e2 = stack;			/* array/string */
-			if (!e2) {
-				fprintf(stderr, "svg forall: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			stack = e2->next;
-			switch (e2->type) {
-			case STR:
-				p = (unsigned char *) &e2->u.s[1];
-				while (*p != '\0') {
-					e3 = elt_new();
-					if (!e3)
-						return;
-					e3->u.v = *p++;
-					push(e3);
-					if (seq_exec(e) != 0)
-						break;
-				}
-				break;
-			case BRK:
-				for (e3 = e2->u.e; e3; e3 = e3->next) {
-					struct elt_s *e4;
-
-					e4 = elt_dup(e3);
-					push(e4);
-					if (seq_exec(e) != 0)
-						break;
-				}
-				break;
-			default:
-				fprintf(stderr, "svg forall: Bad any\n");
-				ps_error = 1;
-				return;
-			}
-			elt_free(e);
-			elt_free(e2);
-			return;
-		}
-		if (strcmp(op, "ft0") == 0) {
-			xysym(op, D_ft0);
-			return;
-		}
-		if (strcmp(op, "ft1") == 0) {
-			xysym(op, D_ft1);
-			return;
-		}
-		if (strcmp(op, "ft4") == 0) {
-			n = pop_free_val();
-			switch (n) {
-			case 1:
-				xysym("ft1", D_ft1);
-				break;
-			case 2:
-				xysym("ft0", D_ft0);
-				break;
-			case 3:
-				xysym("ft513", D_ft513);
-				break;
-			default:
-				xysym("dft0", D_dft0);
-				break;
-			}
-			return;
-		}
-		if (strcmp(op, "ft513") == 0) {
-			xysym(op, D_ft513);
-			return;
-		}
-		break;
-	case 'g':
-		if (strcmp(op, "gcshow") == 0) {
-			show('s');
-			return;
-		}
-		if (strcmp(op, "ge") == 0) {
-			cond(C_GE);
-			return;
-		}
-		if (strcmp(op, "get") == 0) {
-			n = pop_free_val();
-			if (!stack) {
-				fprintf(stderr, "svg get: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			switch (stack->type) {
-			case VAL:
-				if (n != 0) {
-					fprintf(stderr, "svg get: Out of bounds\n");
-					ps_error = 1;
-					return;
-				}
-				return;
-			case STR:
-				s = stack->u.s;
-				if (!s || *s != '(') {
-					fprintf(stderr, "svg get: Not a string\n");
-					if (s)
-						free(s);
-					ps_error = 1;
-					return;
-				}
-				if ((unsigned) n >= strlen(s) - 1) {
-					fprintf(stderr, "svg get: Out of bounds\n");
-					ps_error = 1;
-					return;
-				}
-				stack->type = VAL;
-				stack->u.v = s[n + 1];
-				free(s);
-				return;
-			}
-			e = stack->u.e;
-			e2 = NULL;
-			while (--n >= 0) {
-				if (!e)
-					break;
-				e2 = e;
-				e = e->next;
-			}
-			if (!e) {
-				fprintf(stderr, "svg get: Out of bounds\n");
-				ps_error = 1;
-				return;
-			}
-			if (!e2)
-				stack->u.e = e->next;
-			else
-				e2->next = e->next;
-			e->next = stack->next;
-			elt_free(stack);
-			stack = e;
-			return;
-		}
-		if (strcmp(op, "getinterval") == 0) {
-			int count;
-
-			count = pop_free_val();
-			n = pop_free_val();
-			s = pop_free_str();
-			if (!s || *s != '(') {
-				fprintf(stderr, "svg getinterval: No string\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			if ((unsigned) n >= strlen(s)
-			 || (unsigned) count >= strlen(s) - n) {
-				fprintf(stderr, "svg getinterval: Out of bounds\n");
-				ps_error = 1;
-				return;
-			}
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = STR;
-			e->u.s = malloc(count + 2);
-			e->u.s[0] = '(';
-			memcpy(&e->u.s[1], &s[n + 1], count);
-			e->u.s[count + 1] = '\0';
-			push(e);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "ghd") == 0) {
-			setxysym(op, D_ghd);
-			return;
-		}
-		if (strcmp(op, "ghl") == 0) {
-			xysym(op, D_ghl);
-			return;
-		}
-		if (strcmp(op, "glisq") == 0
-		 || strcmp(op, "gliss") == 0) {
-			gliss(op[4] == 'q');
-			return;
-		}
-		if (strcmp(op, "gt") == 0) {
-			cond(C_GT);
-			return;
-		}
-		if (strcmp(op, "gu") == 0
-		 || strcmp(op, "gd") == 0) {
-			stem(op);
-			return;
-		}
-		if (strcmp(op, "gua") == 0
-		 || strcmp(op, "gda") == 0) {
-			acciac(op);
-			return;
-		}
-		if (strcmp(op, "grestore") == 0) {
-			if (nsave <= 0) {
-				fprintf(stderr, "svg grestore: No gsave\n");
-				ps_error = 1;
-				return;
-			}
-			setg(1);
-			free(gcur.font_n);
-			free(gcur.font_n_old);
-			memcpy(&gcur, &gsave[--nsave], sizeof gcur);
-			return;
-		}
-		if (strcmp(op, "grm") == 0) {
-			xysym(op, D_grm);
-			return;
-		}
-		if (strcmp(op, "gsave") == 0) {
-			if (nsave >= (int) (sizeof gsave / sizeof gsave[0])) {
-				fprintf(stderr, "svg grestore: Too many gsave's\n");
-				ps_error = 1;
-				return;
-			}
-//			setg(1);
-			memcpy(&gsave[nsave++], &gcur, sizeof gsave[0]);
-			gcur.font_n = strdup(gcur.font_n);
-			gcur.font_n_old = strdup(gcur.font_n_old);
-			return;
-		}
-		if (strcmp(op, "gsl") == 0) {
-			float a1, a2, a3, a4, a5, a6, m1, m2;
-
-			setg(1);
-			m2 = gcur.yoffs - pop_free_val();
-			m1 = gcur.xoffs + pop_free_val();
-			a6 = pop_free_val();
-			a5 = pop_free_val();
-			a4 = pop_free_val();
-			a3 = pop_free_val();
-			a2 = pop_free_val();
-			a1 = pop_free_val();
-			fprintf(fout,
-				"<path class=\"stroke\"\n"
-				"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
-					m1, m2, a1, -a2, a3, -a4, a5, -a6);
-			return;
-		}
-		if (strcmp(op, "gxshow") == 0) {
-			show('x');
-			return;
-		}
-		break;
-	case 'H':
-		if (strcmp(op, "Hd") == 0) {
-			setxysym(op, D_Hd);
-			return;
-		}
-		if (strcmp(op, "HD") == 0) {
-			setxysym(op, D_HD);
-			return;
-		}
-		if (strcmp(op, "HDD") == 0) {
-			setxysym(op, D_HDD);
-			return;
-		}
-		break;
-	case 'h':
-		if (strcmp(op, "hd") == 0) {
-			setxysym(op, D_hd);
-			return;
-		}
-		if (strcmp(op, "hl") == 0) {
-			xysym(op, D_hl);
-			return;
-		}
-		if (strcmp(op, "hl1") == 0) {
-			xysym(op, D_hl1);
-			return;
-		}
-		if (strcmp(op, "hl2") == 0) {
-			xysym(op, D_hl2);
-			return;
-		}
-		if (strcmp(op, "hld") == 0) {
-			xysym(op, D_hld);
-			return;
-		}
-		if (strcmp(op, "hyph") == 0) {
-			int d;
-
-			setg(1);
-			y = pop_free_val();
-			x = pop_free_val();
-			w = pop_free_val();
-			d = 25 + (int) w / 20 * 3;
-			n = (w - 15.) / d;
-			x += (w - d * n - 5) / 2;
-			fprintf(fout, "<path class=\"stroke\" stroke-width=\"1.2\"\n"
-				"	stroke-dasharray=\"5,%d\"\n"
-				"	d=\"M%.2f %.2fh%d\"/>\n",
-				d - 5,
-				gcur.xoffs + x, gcur.yoffs - y - gcur.font_s * 0.3,
-				d * n + 5);
-			return;
-		}
-		break;
-	case 'i':
-		if (strcmp(op, "idiv") == 0) {
-			n = pop_free_val();
-			if (!stack || stack->type != VAL || n == 0) {
-				fprintf(stderr, "svg idiv: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			n = (int) stack->u.v / n;
-			stack->u.v = n;
-			return;
-		}
-		if (strcmp(op, "if") == 0) {
-			e = pop(SEQ);		/* sequence */
-			if (!e)
-				return;
-			n = pop_free_val();	/* condition */
-			if (n != 0)
-				seq_exec(e);
-			elt_free(e);
-			return;
-		}
-		if (strcmp(op, "ifelse") == 0) {
-			e2 = pop(SEQ);		/* sequence 2 */
-			e = pop(SEQ);		/* sequence 1 */
-			if (!e || !e2)
-				return;
-			n = pop_free_val();	/* condition */
-			if (n != 0)
-				seq_exec(e);
-			else
-				seq_exec(e2);
-			elt_free(e);
-			elt_free(e2);
-			return;
-		}
-		if (strcmp(op, "imsig") == 0) {
-			xysym(op, D_imsig);
-			return;
-		}
-		if (strcmp(op, "iMsig") == 0) {
-			xysym(op, D_iMsig);
-			return;
-		}
-		if (strcmp(op, "index") == 0) {
-			n = pop_free_val();
-			e = stack;
-			while (--n >= 0) {
-				if (!e)
-					break;
-				e = e->next;
-			}
-			if (!e) {
-				fprintf(stderr, "svg index: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = elt_dup(e);
-			if (!e)
-				return;
-			push(e);
-			return;
-		}
-		break;
-	case 'j':
-		if (strcmp(op, "jshow") == 0) {
-			show('j');
-			return;
-		}
-		break;
-	case 'L':
-		if (strcmp(op, "L") == 0) {
-lineto:
-			path_def();
-			y = pop_free_val();
-			x = pop_free_val();
-			if (x == gcur.cx)
-				path_print("\tv%.2f\n", gcur.cy - y);
-			else if (y == gcur.cy)
-				path_print("\th%.2f\n", x - gcur.cx);
-			else
-				path_print("\tl%.2f %.2f\n",
-					x - gcur.cx, gcur.cy - y);
-			gcur.cx = x;
-			gcur.cy = y;
-			return;
-		}
-	case 'l':
-		if (strcmp(op, "le") == 0) {
-			cond(C_LE);
-			return;
-		}
-		if (strcmp(op, "lt") == 0) {
-			cond(C_LT);
-			return;
-		}
-		if (strcmp(op, "length") == 0) {
-			s = pop_free_str();
-			if (!s || *s != '(') {
-				fprintf(stderr, "svg length: No string\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = strlen(s + 1);
-			push(e);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "lineto") == 0)
-			goto lineto;
-		if (strcmp(op, "lmrd") == 0) {
-			xysym(op, D_lmrd);
-			return;
-		}
-		if (strcmp(op, "load") == 0) {
-			s = pop_free_str();
-			if (!s || *s != '/') {
-				fprintf(stderr, "svg load: No / bad symbol\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			sym = ps_sym_lookup(s + 1);
-			if (!sym) {
-				e = elt_new();
-				if (!e)
-					return;
-				e->type = STR;
-				e->u.s = strdup(s);
-				e->u.s[0] = ' ';	/* internal */
-			} else {
-				e = elt_dup(sym->e);
-				if (!e)
-					return;
-			}
-			free(s);
-			push(e);
-			return;
-		}
-		if (strcmp(op, "longa") == 0) {
-			setxysym(op, D_longa);
-			return;
-		}
-		if (strcmp(op, "lphr") == 0) {
-			xysym(op, D_lphr);
-			return;
-		}
-		if (strcmp(op, "ltr") == 0) {
-			arp_ltr('l');
-			return;
-		}
-		if (strcmp(op, "lyshow") == 0) {
-			show('s');
-			return;
-		}
-		break;
-	case 'M':
-		if (strcmp(op, "M") == 0) {
-moveto:
-			gcur.cy = pop_free_val();
-			gcur.cx = pop_free_val();
-			if (path) {
-				path_print("\tM%.2f %.2f\n",
-					gcur.xoffs + gcur.cx, gcur.yoffs - gcur.cy);
-			} else if (g == 2) {
-				fputs("</text>\n", fout);
-				g = 1;
-			}
-			return;
-		}
-		break;
-	case 'm':
-		if (strcmp(op, "marcato") == 0) {
-			xysym(op, D_marcato);
-			return;
-		}
-		if (strcmp(op, "moveto") == 0)
-			goto moveto;
-		if (strcmp(op, "mphr") == 0) {
-			xysym(op, D_mphr);
-			return;
-		}
-		if (strcmp(op, "mod") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL || x == 0) {
-				fprintf(stderr, "svg: Bad value for mod\n");
-				ps_error = 1;
-				return;
-			}
-			n = (int) stack->u.v % (int) x;
-			stack->u.v = n;
-			return;
-		}
-		if (strcmp(op, "mrep") == 0) {
-			xysym(op, D_mrep);
-			return;
-		}
-		if (strcmp(op, "mrep2") == 0) {
-			xysym(op, D_mrep2);
-			return;
-		}
-		if (strcmp(op, "mrest") == 0) {
-#if 1
-			xysym(op, D_mrest);
-			return;
-#else
-			def_use(D_mrest);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#mrest\"/>\n"
-				"<text style=\"font:bold 15px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
-				x, y, x, y - 28, s + 1);
-			free(s);
-#endif
-			return;
-		}
-		if (strcmp(op, "mul") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg: Bad value for mul\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v *= x;
-			return;
-		}
-		break;
-	case 'n':
-		if (strcmp(op, "ne") == 0) {
-			cond(C_NE);
-			return;
-		}
-		if (strcmp(op, "neg") == 0) {
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg: Bad value for neg\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v = -stack->u.v;
-			return;
+		e = stack->u.e;
+		e2 = NULL;
+		while (--n >= 0) {
+			if (!e)
+				break;
+			e2 = e;
+			e = e->next;
 		}
-		if (strcmp(op, "newpath") == 0) {
-//			path_def();
-			gcur.cx = NaN;
+		if (!e) {
+			fprintf(stderr, "svg get: Out of bounds\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "nt0") == 0) {
-			xysym(op, D_nt0);
+		if (stack->shared) {		/* (read only list) */
+			e = elt_dup(e);
+			if (!e)
+				return;
+			e->next = stack->next;
+			elt_free(stack);
+			stack = e;
 			return;
 		}
-		break;
-	case 'o':
-		if (strcmp(op, "o8va") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			sym = ps_sym_lookup("defl");
-			if (!((int) sym->e->u.v & 1)) {
-				fprintf(fout,
-					"<text x=\"%.2f\" y=\"%.2f\""
-					" style=\"font:italic bold 12px serif\">8"
-					"<tspan dy=\"-4\""
-					" style=\"font-size:10px\">va</tspan></text>\n",
-					x - 5, y);
-				x += 14;
-				w -= 14;
-			} else {
-				w -= 5;
-			}
-			y -= 6;
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-dasharray=\"6,6\""
-				" d=\"M%.2f %.2fh%.2f\"/>\n",
-				x, y, w);
-			if (!((int) sym->e->u.v & 2))
-				fprintf(fout, "<path class=\"stroke\""
-					" d=\"m%.2f %.2fv6\"/>\n",
-					x + w, y);
+		if (!e2)
+			stack->u.e = e->next;
+		else
+			e2->next = e->next;
+		e->next = stack->next;
+		elt_free(stack);
+		stack = e;
+		return;
+	case O_getinterval: {
+		int count;
 
+		count = pop_free_val();
+		n = pop_free_val();
+		s = pop_free_str();
+		if (!s || *s != '(') {
+			fprintf(stderr, "svg getinterval: No string\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "o8vb") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			sym = ps_sym_lookup("defl");
-			if (!((int) sym->e->u.v & 1)) {
-				fprintf(fout,
-					"<text x=\"%.2f\" y=\"%.2f\""
-					" style=\"font:italic bold 12px serif\">8"
-					"<tspan dy=\"-4\""
-					" style=\"font-size:10px\">vb</tspan></text>\n",
-					x - 5, y);
-				x += 8;
-				w -= 8;
-			} else {
-				w -= 5;
-			}
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-dasharray=\"6,6\""
-				" d=\"M%.2f %.2fh%.2f\"/>\n",
-				x, y, w);
-			if (!((int) sym->e->u.v & 2))
-				fprintf(fout, "<path class=\"stroke\""
-					" d=\"m%.2f %.2fv-6\"/>\n",
-					x + w, y);
-
+		if ((unsigned) n >= strlen(s)
+		 || (unsigned) count >= strlen(s) - n) {
+			fprintf(stderr, "svg getinterval: Out of bounds\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "oct") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			fprintf(fout, "<text style=\"font:12px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\">8</text>\n",
-				x, y);
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "opend") == 0) {
-			xysym(op, D_opend);
+		e->type = STR;
+		e->u.s = str_new(count + 2);
+		e->u.s[0] = '(';
+		memcpy(&e->u.s[1], &s[n + 1], count);
+		e->u.s[count + 1] = '\0';
+		push(e);
+		str_free(s);
+		return;
+	    }
+	case O_ghd:
+		setxysym(op, D_ghd);
+		return;
+	case O_ghl:
+		xysym(op, D_ghl);
+		return;
+	case O_glisq:
+	case O_gliss:
+		gliss(op[4] == 'q');
+		return;
+	case O_gt:
+		cond(C_GT);
+		return;
+	case O_gu:
+	case O_gd:
+		stem(op);
+		return;
+	case O_gua:
+	case O_gda:
+		acciac(op);
+		return;
+	case O_grestore:
+		if (nsave <= 0) {
+			fprintf(stderr, "svg grestore: No gsave\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "or") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg or: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v = (int) x & (int) stack->u.v;
+		setg(1);
+		free(gcur.font_n);
+		free(gcur.font_n_old);
+		memcpy(&gcur, &gsave[--nsave], sizeof gcur);
+		return;
+	case O_grm:
+		xysym(op, D_grm);
+		return;
+	case O_gsave:
+		if (nsave >= (int) (sizeof gsave / sizeof gsave[0])) {
+			fprintf(stderr, "svg grestore: Too many gsave's\n");
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'p':
-		if (strcmp(op, "pclef") == 0) {
-			xysym(op, D_pclef);
+//			setg(1);
+		memcpy(&gsave[nsave++], &gcur, sizeof gsave[0]);
+		gcur.font_n = strdup(gcur.font_n);
+		gcur.font_n_old = strdup(gcur.font_n_old);
+		return;
+	case O_gsl: {
+		float a1, a2, a3, a4, a5, a6, m1, m2;
+
+		setg(1);
+		m2 = gcur.yoffs - pop_free_val();
+		m1 = gcur.xoffs + pop_free_val();
+		a6 = pop_free_val();
+		a5 = pop_free_val();
+		a4 = pop_free_val();
+		a3 = pop_free_val();
+		a2 = pop_free_val();
+		a1 = pop_free_val();
+		fprintf(fout,
+			"<path class=\"stroke\"\n"
+			"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
+				m1, m2, a1, -a2, a3, -a4, a5, -a6);
+		return;
+	    }
+	case O_gxshow:
+		show('x');
+		return;
+	case O_Hd:
+		setxysym(op, D_Hd);
+		return;
+	case O_HD:
+		setxysym(op, D_HD);
+		return;
+	case O_HDD:
+		setxysym(op, D_HDD);
+		return;
+	case O_hd:
+		setxysym(op, D_hd);
+		return;
+	case O_hl:
+		xysym(op, D_hl);
+		return;
+	case O_hl1:
+		xysym(op, D_hl1);
+		return;
+	case O_hl2:
+		xysym(op, D_hl2);
+		return;
+	case O_hld:
+		xysym(op, D_hld);
+		return;
+	case O_hyph: {
+		int d;
+
+		setg(1);
+		y = pop_free_val();
+		x = pop_free_val();
+		w = pop_free_val();
+		d = 25 + (int) w / 20 * 3;
+		n = (w - 15.) / d;
+		x += (w - d * n - 5) / 2;
+		fprintf(fout, "<path class=\"stroke\" stroke-width=\"1.2\"\n"
+			"	stroke-dasharray=\"5,%d\"\n"
+			"	d=\"M%.2f %.2fh%d\"/>\n",
+			d - 5,
+			gcur.xoffs + x, gcur.yoffs - y - gcur.font_s * 0.3,
+			d * n + 5);
+		return;
+	    }
+	case O_idiv:
+		n = pop_free_val();
+		if (!stack || stack->type != VAL || n == 0) {
+			fprintf(stderr, "svg idiv: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "ped") == 0) {
-			xysym(op, D_ped);
+		n = (int) stack->u.v / n;
+		stack->u.v = n;
+		return;
+	case O_if:
+		e = pop(SEQ);		/* sequence */
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "pedoff") == 0) {
-			xysym(op, D_pedoff);
+		n = pop_free_val();	/* condition */
+		if (n != 0)
+			seq_exec(e);
+		elt_free(e);
+		return;
+	case O_ifelse:
+		e2 = pop(SEQ);		/* sequence 2 */
+		e = pop(SEQ);		/* sequence 1 */
+		if (!e || !e2)
 			return;
+		n = pop_free_val();	/* condition */
+		if (n != 0)
+			seq_exec(e);
+		else
+			seq_exec(e2);
+		elt_free(e);
+		elt_free(e2);
+		return;
+	case O_imsig:
+		xysym(op, D_imsig);
+		return;
+	case O_iMsig:
+		xysym(op, D_iMsig);
+		return;
+	case O_index:
+		n = pop_free_val();
+		e = stack;
+		while (--n >= 0) {
+			if (!e)
+				break;
+			e = e->next;
 		}
-		if (strcmp(op, "pf") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg pf: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<text style=\"font:bold italic 16px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
+		if (!e) {
+			fprintf(stderr, "svg index: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "pmsig") == 0) {
-			xysym(op, D_pmsig);
+		e = elt_dup(e);
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "pMsig") == 0) {
-			xysym(op, D_pMsig);
+		push(e);
+		return;
+	case O_jshow:
+		show('j');
+		return;
+	case O_L:
+lineto:
+		path_def();
+		y = pop_free_val();
+		x = pop_free_val();
+		if (x == gcur.cx)
+			path_rel('v', gcur.cy - y, 0);
+		else if (y == gcur.cy)
+			path_rel('h', x - gcur.cx, 0);
+		else
+			path_rel('l', x - gcur.cx, gcur.cy - y);
+		gcur.cx = x;
+		gcur.cy = y;
+		return;
+	case O_le:
+		cond(C_LE);
+		return;
+	case O_lt:
+		cond(C_LT);
+		return;
+	case O_length:
+		s = pop_free_str();
+		if (!s || *s != '(') {
+			fprintf(stderr, "svg length: No string\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "pop") == 0) {
-			if (!stack) {
-				fprintf(stderr, "svg pop: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = pop(stack->type);
-			elt_free(e);
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "pshhd") == 0) {
-			setxysym(op, D_pshhd);
+		e->type = VAL;
+		e->u.v = strlen(s + 1);
+		push(e);
+		str_free(s);
+		return;
+	case O_lineto:
+		goto lineto;
+	case O_lmrd:
+		xysym(op, D_lmrd);
+		return;
+	case O_load:
+		s = pop_free_str();
+		if (!s || *s != '/') {
+			fprintf(stderr, "svg load: No / bad symbol\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "pdshhd") == 0) {
-			setxysym("pshhd", D_pshhd);
-			return;
+		sym = ps_sym_lookup(s + 1);
+		if (!sym) {
+			e = elt_new();
+			if (!e)
+				return;
+			e->type = STR;
+			e->u.s = str_dup(s);
+			e->u.s[0] = ' ';	/* internal */
+		} else {
+			e = elt_dup(sym->e);
+			if (!e)
+				return;
 		}
-		if (strcmp(op, "pfthd") == 0) {
-			setxysym(op, D_pfthd);
-			return;
+		str_free(s);
+		push(e);
+		return;
+	case O_longa:
+		setxysym(op, D_longa);
+		return;
+	case O_lphr:
+		xysym(op, D_lphr);
+		return;
+	case O_ltr:
+		arp_ltr('l');
+		return;
+	case O_lyshow:
+		show('s');
+		return;
+	case O_M:
+moveto:
+		gcur.cy = pop_free_val();
+		gcur.cx = pop_free_val();
+		if (path_len) {
+			path_mv = 0;
+			path_print("\tM%.2f %.2f\n",
+				gcur.xoffs + gcur.cx, gcur.yoffs - gcur.cy);
+		} else if (g == 2) {
+			fputs("</text>\n", fout);
+			g = 1;
 		}
-		if (strcmp(op, "pdfthd") == 0) {
-			setxysym("pfthd", D_pfthd);
+		return;
+	case O_marcato:
+		xysym(op, D_marcato);
+		return;
+	case O_moveto:
+		goto moveto;
+	case O_mphr:
+		xysym(op, D_mphr);
+		return;
+	case O_mod:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL || x == 0) {
+			fprintf(stderr, "svg: Bad value for mod\n");
+			ps_error = 1;
 			return;
 		}
-#if 0
-//fixme: cannot work because duplication...
-		if (strcmp(op, "put") == 0) {
-			int v;
-
-			v = pop_free_val();
-			n = pop_free_val();
-			if (!stack) {
-				fprintf(stderr, "svg put: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			s = pop_free_str();
-			if (!s || *s != '(') {
-				fprintf(stderr, "svg put: No string\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			if ((unsigned) n >= strlen(s) - 1) {
-				fprintf(stderr, "svg put: Out of bounds\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-//fixme: should keep the original string...
-			s[n + 1] = v;
-			free(s);
+		n = (int) stack->u.v % (int) x;
+		stack->u.v = n;
+		return;
+	case O_mrep:
+		xysym(op, D_mrep);
+		return;
+	case O_mrep2:
+		xysym(op, D_mrep2);
+		return;
+	case O_mrest:
+#if 1
+		xysym(op, D_mrest);
+		return;
+#else
+		def_use(D_mrest);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg: No string\n");
+			ps_error = 1;
 			return;
 		}
+		fprintf(fout, "<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#mrest\"/>\n"
+			"<text style=\"font:bold 15px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
+			x, y, x, y - 28, s + 1);
+		str_free(s);
 #endif
-		break;
-	case 'R':
-		if (strcmp(op, "RC") == 0) {
-			float c1, c2, c3, c4;
-
-rcurveto:
-			path_def();
-			y = pop_free_val();
-			x = pop_free_val();
-			c4 = pop_free_val();
-			c3 = pop_free_val();
-			c2 = pop_free_val();
-			c1 = pop_free_val();
-			path_print("\tc%.2f %.2f %.2f %.2f %.2f %.2f\n",
-				c1, -c2, c3, -c4, x, -y);
-			gcur.cx += x;
-			gcur.cy += y;
-			return;
-		}
-		if (strcmp(op, "RL") == 0) {
-rlineto:
-			path_def();
-			y = pop_free_val();
-			x = pop_free_val();
-			if (x == 0)
-				path_print("\tv%.2f\n", -y);
-			else if (y == 0)
-				path_print("\th%.2f\n", x);
-			else
-				path_print("\tl%.2f %.2f\n", x, -y);
-			gcur.cx += x;
-			gcur.cy += y;
+		return;
+	case O_mul:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg: Bad value for mul\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "RM") == 0) {
-rmoveto:
-			y = pop_free_val();
-			x = pop_free_val();
-			if (path) {
-				path_print("\tm%.2f %.2f\n", x, -y);
-			} else if (g == 2) {
-				fputs("</text>\n", fout);
-				g = 1;
-			}
-			gcur.cx += x;
-			gcur.cy += y;
+		stack->u.v *= x;
+		return;
+	case O_ne:
+		cond(C_NE);
+		return;
+	case O_neg:
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg: Bad value for neg\n");
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'r':
-		if (strcmp(op, "r00") == 0) {
-			setxysym(op, D_r00);
-			return;
+		stack->u.v = -stack->u.v;
+		return;
+	case O_newpath:
+//			path_def();
+		gcur.cx = NaN;
+		return;
+	case O_nt0:
+		xysym(op, D_nt0);
+		return;
+	case O_o8va:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		sym = ps_sym_lookup("defl");
+		if (!((int) sym->e->u.v & 1)) {
+			fprintf(fout,
+				"<text x=\"%.2f\" y=\"%.2f\""
+				" style=\"font:italic bold 12px serif\">8"
+				"<tspan dy=\"-4\""
+				" style=\"font-size:10px\">va</tspan></text>\n",
+				x - 5, y);
+			x += 14;
+			w -= 14;
+		} else {
+			w -= 5;
 		}
-		if (strcmp(op, "r0") == 0) {
-			setxysym(op, D_r0);
-			return;
+		y -= 6;
+		fprintf(fout,
+			"<path class=\"stroke\" stroke-dasharray=\"6,6\""
+			" d=\"M%.2f %.2fh%.2f\"/>\n",
+			x, y, w);
+		if (!((int) sym->e->u.v & 2))
+			fprintf(fout, "<path class=\"stroke\""
+				" d=\"m%.2f %.2fv6\"/>\n",
+				x + w, y);
+
+		return;
+	case O_o8vb:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		sym = ps_sym_lookup("defl");
+		if (!((int) sym->e->u.v & 1)) {
+			fprintf(fout,
+				"<text x=\"%.2f\" y=\"%.2f\""
+				" style=\"font:italic bold 12px serif\">8"
+				"<tspan dy=\"-4\""
+				" style=\"font-size:10px\">vb</tspan></text>\n",
+				x - 5, y);
+			x += 8;
+			w -= 8;
+		} else {
+			w -= 5;
 		}
-		if (strcmp(op, "r1") == 0) {
-			setxysym(op, D_r1);
+		fprintf(fout,
+			"<path class=\"stroke\" stroke-dasharray=\"6,6\""
+			" d=\"M%.2f %.2fh%.2f\"/>\n",
+			x, y, w);
+		if (!((int) sym->e->u.v & 2))
+			fprintf(fout, "<path class=\"stroke\""
+				" d=\"m%.2f %.2fv-6\"/>\n",
+				x + w, y);
+
+		return;
+	case O_oct:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		fprintf(fout, "<text style=\"font:12px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\">8</text>\n",
+			x, y);
+		return;
+	case O_opend:
+		xysym(op, D_opend);
+		return;
+	case O_or:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg or: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "r2") == 0) {
-			setxysym(op, D_r2);
+		stack->u.v = (int) x & (int) stack->u.v;
+		return;
+	case O_pclef:
+		xysym(op, D_pclef);
+		return;
+	case O_ped:
+		xysym(op, D_ped);
+		return;
+	case O_pedoff:
+		xysym(op, D_pedoff);
+		return;
+	case O_pf:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg pf: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "r4") == 0) {
-			setxysym(op, D_r4);
+		fprintf(fout, "<text style=\"font:bold italic 16px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\">%s</text>\n",
+			x, y, s + 1);
+		str_free(s);
+		return;
+	case O_pmsig:
+		xysym(op, D_pmsig);
+		return;
+	case O_pMsig:
+		xysym(op, D_pMsig);
+		return;
+	case O_pop:
+		if (!stack) {
+			fprintf(stderr, "svg pop: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "r8") == 0) {
-			setxysym(op, D_r8);
+		e = pop(stack->type);
+		elt_free(e);
+		return;
+	case O_pshhd:
+		setxysym(op, D_pshhd);
+		return;
+	case O_pdshhd:
+		setxysym("pshhd", D_pshhd);
+		return;
+	case O_pfthd:
+		setxysym(op, D_pfthd);
+		return;
+	case O_pdfthd:
+		setxysym("pfthd", D_pfthd);
+		return;
+#if 0
+//fixme: cannot work because duplication...
+	case O_put: {
+		int v;
+
+		v = pop_free_val();
+		n = pop_free_val();
+		if (!stack) {
+			fprintf(stderr, "svg put: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "r16") == 0) {
-			setxysym(op, D_r16);
+		s = pop_free_str();
+		if (!s || *s != '(') {
+			fprintf(stderr, "svg put: No string\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "r32") == 0) {
-			setxysym(op, D_r32);
+		if ((unsigned) n >= strlen(s) - 1) {
+			fprintf(stderr, "svg put: Out of bounds\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "r64") == 0) {
-			setxysym(op, D_r64);
+//fixme: should keep the original string...
+		s[n + 1] = v;
+		str_free(s);
+		return;
+	    }
+#endif
+	case O_RC: {
+		float c1, c2, c3, c4;
+
+rcurveto:
+		path_def();
+		y = pop_free_val();
+		x = pop_free_val();
+		c4 = pop_free_val();
+		c3 = pop_free_val();
+		c2 = pop_free_val();
+		c1 = pop_free_val();
+		path_print("\tc%.2f %.2f %.2f %.2f %.2f %.2f\n",
+			c1, -c2, c3, -c4, x, -y);
+		gcur.cx += x;
+		gcur.cy += y;
+		return;
+	    }
+	case O_RL:
+rlineto:
+		path_def();
+		y = pop_free_val();
+		x = pop_free_val();
+		if (x == 0)
+			path_rel('v', -y, 0);
+		else if (y == 0)
+			path_rel('h', x, 0);
+		else
+			path_rel('l', x, -y);
+		gcur.cx += x;
+		gcur.cy += y;
+		return;
+	case O_RM:
+rmoveto:
+		y = pop_free_val();
+		x = pop_free_val();
+		if (path_len) {
+			path_rel('m', x, -y);
+		} else if (g == 2) {
+			fputs("</text>\n", fout);
+			g = 1;
+		}
+		gcur.cx += x;
+		gcur.cy += y;
+		return;
+	case O_r00:
+		setxysym(op, D_r00);
+		return;
+	case O_r0:
+		setxysym(op, D_r0);
+		return;
+	case O_r1:
+		setxysym(op, D_r1);
+		return;
+	case O_r2:
+		setxysym(op, D_r2);
+		return;
+	case O_r4:
+		setxysym(op, D_r4);
+		return;
+	case O_r8:
+		setxysym(op, D_r8);
+		return;
+	case O_r16:
+		setxysym(op, D_r16);
+		return;
+	case O_r32:
+		setxysym(op, D_r32);
+		return;
+	case O_r64:
+		setxysym(op, D_r64);
+		return;
+	case O_r128:
+		setxysym(op, D_r128);
+		return;
+	case O_rdots:
+		xysym(op, D_rdots);
+		return;
+	case O_rcurveto:
+		goto rcurveto;
+	case O_rlineto:
+		goto rlineto;
+	case O_rmoveto:
+		goto rmoveto;
+	case O_roll: {
+		int i, j;
+
+		j = pop_free_val();
+		n = pop_free_val();
+		if (n <= 0) {
+			fprintf(stderr, "svg roll: Invalid value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "r128") == 0) {
-			setxysym(op, D_r128);
-			return;
+		if (j > 0) {
+			j = j % n;
+			if (j > n / 2)
+				j -= n;
+		} else if (j < 0) {
+			j = -(-j % n);
+			if (j < -n / 2)
+				j += n;
 		}
-		if (strcmp(op, "rdots") == 0) {
-			xysym(op, D_rdots);
+		if (j == 0)
 			return;
-		}
-		if (strcmp(op, "rcurveto") == 0)
-			goto rcurveto;
-		if (strcmp(op, "rlineto") == 0)
-			goto rlineto;
-		if (strcmp(op, "rmoveto") == 0)
-			goto rmoveto;
-		if (strcmp(op, "roll") == 0) {
-			int i, j;
-
-			j = pop_free_val();
-			n = pop_free_val();
-			if (n <= 0) {
-				fprintf(stderr, "svg roll: Invalid value\n");
+		e2 = stack;		/* check the stack */
+		i = n;
+		for (;;) {
+			if (!e2) {
+				fprintf(stderr, "svg roll: Stack empty\n");
 				ps_error = 1;
 				return;
 			}
-			if (j > 0) {
-				j = j % n;
-				if (j > n / 2)
-					j -= n;
-			} else if (j < 0) {
-				j = -(-j % n);
-				if (j < -n / 2)
-					j += n;
-			}
-			if (j == 0)
-				return;
-			e2 = stack;		/* check the stack */
-			i = n;
-			for (;;) {
-				if (!e2) {
-					fprintf(stderr, "svg roll: Stack empty\n");
-					ps_error = 1;
-					return;
-				}
-				if (--i <= 0)
-					break;
-				e2 = e2->next;
-			}
-			if (j > 0) {
-				while (j-- > 0) {
-					e = stack;
-					stack = e->next;
-					e->next = e2->next;
-					e2->next = e;
-					e2 = e;
-				}
-				return;
-			}
-			while (j++ < 0) {
+			if (--i <= 0)
+				break;
+			e2 = e2->next;
+		}
+		if (j > 0) {
+			while (j-- > 0) {
 				e = stack;
-				for (i = 0; i < n - 2; i++)
-					e = e->next;
-				e2 = e->next;
+				stack = e->next;
 				e->next = e2->next;
-				e2->next = stack;
-				stack = e2;
-			}
-			return;
-		}
-		if (strcmp(op, "repbra") == 0) {
-			int i;
-
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			i = pop_free_val();
-			h = pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg repbra: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout,
-				"<text x=\"%.2f\" y=\"%.2f\">",
-				x + 4, y - h);
-			xml_str_out(s + 1);
-			fprintf(fout,
-				"</text>\n"
-				"<path class=\"stroke\"\n"
-				"	d=\"M%.2f %.2f",
-				x, y);
-			if (i & 1)
-				fprintf(fout, "m0 20v-20");
-			fprintf(fout, "h%.2f", w);
-			if (i & 2)
-				fprintf(fout, "v20");
-			fprintf(fout, "\"/>\n");
-			free(s);
-			return;
-		}
-		if (strcmp(op, "repeat") == 0) {
-			e = pop(SEQ);		/* sequence */
-			if (!e)
-				return;
-			n = pop_free_val();	/* n times */
-			if ((unsigned) n >= 100) {
-				fprintf(stderr, "svg repeat: Too high value\n");
-				ps_error = 1;
-			}
-			while (--n >= 0) {
-				if (seq_exec(e))
-					break;		/* exit */
-				if (ps_error)
-					break;
+				e2->next = e;
+				e2 = e;
 			}
-			elt_free(e);
 			return;
 		}
-		if (strcmp(op, "rotate") == 0) {
-			float x, y, _sin, _cos;
-
-			setg(0);
-
-			// convert orig and currentpoint coord to absolute coord
-			x = gcur.xoffs;
-			y = -gcur.yoffs;
-			_sin = gcur.sin;
-			_cos = gcur.cos;
-			gcur.xoffs = x * _cos + y * _sin;
-			gcur.yoffs = -x * _sin + y * _cos;	// PS orientation
-
-			x = gcur.cx * _cos + gcur.cy * _sin;
-			y = -gcur.cx * _sin + gcur.cy * _cos;
-
-			// rotate
-			gcur.rotate -= pop_free_val();
-			if (gcur.rotate > 180)
-				gcur.rotate -= 360;
-			else if (gcur.rotate <= -180)
-				gcur.rotate += 360;
-			h = gcur.rotate * M_PI / 180;
-			gcur.sin = _sin = sin(h);
-			gcur.cos = _cos = cos(h);
-			gcur.cx = x * _cos - y * _sin;
-			gcur.cy = x * _sin + y * _cos;
-			x = gcur.xoffs;
-			y = gcur.yoffs;
-			gcur.xoffs = x * _cos - y * _sin;
-			gcur.yoffs = -(x * _sin + y * _cos);	// SVG orientation
-			return;
+		while (j++ < 0) {
+			e = stack;
+			for (i = 0; i < n - 2; i++)
+				e = e->next;
+			e2 = e->next;
+			e->next = e2->next;
+			e2->next = stack;
+			stack = e2;
 		}
-		break;
-	case 'S':
-		if (strcmp(op, "SL") == 0) {
-			float c1, c2, c3, c4, c5, c6, l2;
-			float a1, a2, a3, a4, a5, a6, m1, m2;
-
-			setg(1);
-			m2 = gcur.yoffs - pop_free_val();
-			m1 = gcur.xoffs + pop_free_val();
-			a6 = pop_free_val();
-			a5 = pop_free_val();
-			a4 = pop_free_val();
-			a3 = pop_free_val();
-			a2 = pop_free_val();
-			a1 = pop_free_val();
-			l2 = pop_free_val();
-			pop_free_val();		// always '0'
-			c6 = pop_free_val();
-			c5 = pop_free_val();
-			c4 = pop_free_val();
-			c3 = pop_free_val();
-			c2 = pop_free_val();
-			c1 = pop_free_val();
-			fprintf(fout,
-				"<path class=\"fill\"\n"
-				"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\n"
-				"	v%.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
-				m1, m2, a1, -a2, a3, -a4, a5, -a6,
-				-l2, c1, -c2, c3, -c4, c5, -c6);
+		return;
+	    }
+	case O_repbra: {
+		int i;
+
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		i = pop_free_val();
+		h = pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg repbra: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "SLW") == 0) {
-			gcur.linewidth = pop_free_val();
+		fprintf(fout,
+			"<text x=\"%.2f\" y=\"%.2f\">",
+			x + 4, y - h);
+		xml_str_out(s + 1);
+		fprintf(fout,
+			"</text>\n"
+			"<path class=\"stroke\"\n"
+			"	d=\"M%.2f %.2f",
+			x, y);
+		if (i & 1)
+			fprintf(fout, "m0 20v-20");
+		fprintf(fout, "h%.2f", w);
+		if (i & 2)
+			fprintf(fout, "v20");
+		fprintf(fout, "\"/>\n");
+		str_free(s);
+		return;
+	    }
+	case O_repeat:
+		e = pop(SEQ);		/* sequence */
+		if (!e)
 			return;
+		n = pop_free_val();	/* n times */
+		if ((unsigned) n >= 100) {
+			fprintf(stderr, "svg repeat: Too high value\n");
+			ps_error = 1;
 		}
-		break;
-	case 's':
-		if (strcmp(op, "scale") == 0) {
-			y = pop_free_val();
-			x = pop_free_val();
-			gcur.xoffs /= x;
-			gcur.yoffs /= y;
-			gcur.cx /= x;
-			gcur.cy /= y;
-			gcur.xscale *= x;
-			gcur.yscale *= y;
-			return;
+		while (--n >= 0) {
+			if (seq_exec(e))
+				break;		/* exit */
+			if (ps_error)
+				break;
 		}
-		if (strcmp(op, "scalefont") == 0) {
-			gcur.font_s = pop_free_val();
+		elt_free(e);
+		return;
+	case O_rotate: {
+		float x, y, _sin, _cos;
+
+		setg(0);
+
+		// convert orig and currentpoint coord to absolute coord
+		x = gcur.xoffs;
+		y = -gcur.yoffs;
+		_sin = gcur.sin;
+		_cos = gcur.cos;
+		gcur.xoffs = x * _cos + y * _sin;
+		gcur.yoffs = -x * _sin + y * _cos;	// PS orientation
+
+		x = gcur.cx * _cos + gcur.cy * _sin;
+		y = -gcur.cx * _sin + gcur.cy * _cos;
+
+		// rotate
+		gcur.rotate -= pop_free_val();
+		if (gcur.rotate > 180)
+			gcur.rotate -= 360;
+		else if (gcur.rotate <= -180)
+			gcur.rotate += 360;
+		h = gcur.rotate * M_PI / 180;
+		gcur.sin = _sin = sin(h);
+		gcur.cos = _cos = cos(h);
+		gcur.cx = x * _cos - y * _sin;
+		gcur.cy = x * _sin + y * _cos;
+		x = gcur.xoffs;
+		y = gcur.yoffs;
+		gcur.xoffs = x * _cos - y * _sin;
+		gcur.yoffs = -(x * _sin + y * _cos);	// SVG orientation
+		return;
+	    }
+	case O_SL: {
+		float c1, c2, c3, c4, c5, c6, l2;
+		float a1, a2, a3, a4, a5, a6, m1, m2;
+
+		setg(1);
+		m2 = gcur.yoffs - pop_free_val();
+		m1 = gcur.xoffs + pop_free_val();
+		a6 = pop_free_val();
+		a5 = pop_free_val();
+		a4 = pop_free_val();
+		a3 = pop_free_val();
+		a2 = pop_free_val();
+		a1 = pop_free_val();
+		l2 = pop_free_val();
+		pop_free_val();		// always '0'
+		c6 = pop_free_val();
+		c5 = pop_free_val();
+		c4 = pop_free_val();
+		c3 = pop_free_val();
+		c2 = pop_free_val();
+		c1 = pop_free_val();
+		fprintf(fout,
+			"<path class=\"fill\"\n"
+			"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\n"
+			"	v%.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
+			m1, m2, a1, -a2, a3, -a4, a5, -a6,
+			-l2, c1, -c2, c3, -c4, c5, -c6);
+		return;
+	    }
+	case O_SLW:
+		gcur.linewidth = pop_free_val();
+		return;
+	case O_scale:
+		y = pop_free_val();
+		x = pop_free_val();
+		gcur.xoffs /= x;
+		gcur.yoffs /= y;
+		gcur.cx /= x;
+		gcur.cy /= y;
+		gcur.xscale *= x;
+		gcur.yscale *= y;
+		return;
+	case O_scalefont:
+		gcur.font_s = pop_free_val();
+		return;
+	case O_search: {
+		char *p;
+
+		e = pop(STR);			/* seek */
+		e2 = pop(STR);			/* string */
+		if (!e || !e2
+		 || e->u.s[0] != '(' || e2->u.s[0] != '(') {
+			fprintf(stderr, "svg search: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "search") == 0) {
-			char *p;
-
-			e = pop(STR);			/* seek */
-			e2 = pop(STR);			/* string */
-			if (!e || !e2
-			 || e->u.s[0] != '(' || e2->u.s[0] != '(') {
-				fprintf(stderr, "svg search: No string\n");
-				ps_error = 1;
+		p = strstr(&e2->u.s[1], &e->u.s[1]);
+		if (p) {
+			struct elt_s *e3;
+			int l1, l2, l3;
+
+			l1 = p - e2->u.s;
+			l2 = strlen(e->u.s);
+			l3 = strlen(e2->u.s) - l2 - l1 + 2;
+			e3 = elt_new();
+			if (!e3)
 				return;
-			}
-			p = strstr(&e2->u.s[1], &e->u.s[1]);
-			if (p) {
-				struct elt_s *e3;
-				int l1, l2, l3;
-
-				l1 = p - e2->u.s;
-				l2 = strlen(e->u.s);
-				l3 = strlen(e2->u.s) - l2 - l1 + 2;
-				e3 = elt_new();
-				if (!e3)
-					return;
-				e3->type = STR;
-				e3->u.s = malloc(l3);
-				e3->u.s[0] = '(';
-				memcpy(&e3->u.s[1],
-					&e2->u.s[l1 + l2 - 2],
-					l3 - 1);
-				e3->u.s[l1 + l2 - 1] = '\0';
-				push(e3);
-				push(e);
-				e2->u.s[l1] = '\0';
-				push (e2);
-				e = elt_new();
-				if (!e)
-					return;
-				e->type = VAL;
-				e->u.v = 1;
-			} else {
-				push(e2);
-				free(e->u.s);
-				e->type = VAL;
-				e->u.v = 0;
-			}
+			e3->type = STR;
+			e3->u.s = str_new(l3);
+			e3->u.s[0] = '(';
+			memcpy(&e3->u.s[1],
+				&e2->u.s[l1 + l2 - 2],
+				l3 - 1);
+			e3->u.s[l1 + l2 - 1] = '\0';
+			push(e3);
 			push(e);
+			e2->u.s = str_w(e2->u.s);
+			e2->u.s[l1] = '\0';
+			push (e2);
+			e = elt_new();
+			if (!e)
+				return;
+			e->type = VAL;
+			e->u.v = 1;
+		} else {
+			push(e2);
+			str_free(e->u.s);
+			e->type = VAL;
+			e->u.v = 0;
+		}
+		push(e);
+		return;
+	    }
+	case O_selectfont:
+		h = pop_free_val();
+		s = pop_free_str();
+		if (!s
+		 || *s != '/') {
+			fprintf(stderr, "svg selectfont: No / bad font\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "selectfont") == 0) {
-			h = pop_free_val();
-			s = pop_free_str();
-			if (!s
-			 || *s != '/') {
-				fprintf(stderr, "svg selectfont: No / bad font\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			if (gcur.font_s != h
-			 || strcmp(s, gcur.font_n) != 0) {
-				free(gcur.font_n_old);
-				gcur.font_n_old = gcur.font_n;
-				gcur.font_n = strdup(s);
-				gcur.font_s = h;
-			} else {
-				free(s);
-			}
+		if (gcur.font_s != h
+		 || strcmp(s, gcur.font_n) != 0) {
+			free(gcur.font_n_old);
+			gcur.font_n_old = gcur.font_n;
+			gcur.font_n = strdup(s);
+			gcur.font_s = h;
+		}
+		str_free(s);
+		return;
+	case O_sep0:
+		x = pop_free_val();
+		w = pop_free_val();
+		fprintf(fout,
+			"<path class=\"stroke\"\n"
+			"	d=\"M%.2f %.2fh%.2f\"/>\n",
+				gcur.xoffs + x, gcur.yoffs, w);
+		return;
+	case O_setdash: {
+		char *p;
+
+		n = pop_free_val();
+		e = pop(BRK);
+		if (!e) {
+			fprintf(stderr, "svg setdash: Bad pattern\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "sep0") == 0) {
-			x = pop_free_val();
-			w = pop_free_val();
-			fprintf(fout,
-				"<path class=\"stroke\"\n"
-				"	d=\"M%.2f %.2fh%.2f\"/>\n",
-					gcur.xoffs + x, gcur.yoffs, w);
+		e = e->u.e;
+		if (!e) {
+			gcur.dash[0] = '\0';
 			return;
 		}
-		if (strcmp(op, "setdash") == 0) {
-			char *p;
-
-			n = pop_free_val();
-			e = pop(BRK);
-			if (!e) {
-				fprintf(stderr, "svg setdash: Bad pattern\n");
+		p = gcur.dash;
+		if (n != 0)
+			p += sprintf(p, " stroke-dashoffset=\"%d\"", n);
+		p += sprintf(p, " stroke-dasharray=\"");
+		do {
+			if (e->type != VAL) {
+				fprintf(stderr, "svg setdash: Bad pattern type\n");
 				ps_error = 1;
 				return;
 			}
-			e = e->u.e;
-			if (!e) {
-				gcur.dash[0] = '\0';
+			if (p >= &gcur.dash[sizeof gcur.dash] - 10) {
+				fprintf(stderr, "svg setdash: Pattern too wide\n");
+				ps_error = 1;
 				return;
 			}
-			p = gcur.dash;
-			if (n != 0)
-				p += sprintf(p, " stroke-dashoffset=\"%d\"", n);
-			p += sprintf(p, " stroke-dasharray=\"");
-			do {
-				if (e->type != VAL) {
-					fprintf(stderr, "svg setdash: Bad pattern type\n");
-					ps_error = 1;
-					return;
-				}
-				if (p >= &gcur.dash[sizeof gcur.dash] - 10) {
-					fprintf(stderr, "svg setdash: Pattern too wide\n");
-					ps_error = 1;
-					return;
-				}
-				p += sprintf(p, "%d,", (int) e->u.v);
-				e = e->next;
-			} while (e);
-			p--;
-			sprintf(p, "\"");
-			return;
-		}
-		if (strcmp(op, "setfont") == 0) {
-			return;
-		}
-		if (strcmp(op, "setgray") == 0) {
-			n = pop_free_val() * 255;
-			gcur.rgb = (n << 16) | (n << 8) | n;
-			return;
-		}
-		if (strcmp(op, "setlinewidth") == 0) {
-			gcur.linewidth = pop_free_val();
-			return;
-		}
+			p += sprintf(p, "%d,", (int) e->u.v);
+			e = e->next;
+		} while (e);
+		p--;
+		sprintf(p, "\"");
+		return;
+	    }
+	case O_setfont:
+		return;
+	case O_setgray:
+		n = pop_free_val() * 255;
+		gcur.rgb = (n << 16) | (n << 8) | n;
+		return;
+	case O_setlinewidth:
+		gcur.linewidth = pop_free_val();
+		return;
 //fixme: use 'use' for flags
-		if (strcmp(op, "sfu") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v + 3.5;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
-			fprintf(fout,
-				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-				"<path class=\"fill\"\n"
-				"	d=\"",
-				x, y, -h);
-			y -= h;
-			if (n == 1) {
-				fprintf(fout,
-					"M%.2f %.2fc0.6 5.6 9.6 9 5.6 18.4\n"
-					"	1.6 -6 -1.3 -11.6 -5.6 -12.8\n",
-					x, y);
-			} else {
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fc0.9 3.7 9.1 6.4 6 12.4\n"
-						"	1 -5.4 -4.2 -8.4 -6 -8.4\n",
-						x, y);
-					y += 5.4;
-				}
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sfd") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v - 3.5;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
+	case O_sfu:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = ps_sym_lookup("x");
+		x = gcur.xoffs + sym->e->u.v + 3.5;
+		sym = ps_sym_lookup("y");
+		y = gcur.yoffs - sym->e->u.v;
+		fprintf(fout,
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		if (n == 1) {
 			fprintf(fout,
-				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-				"<path class=\"fill\"\n"
-				"	d=\"",
-				x, y, -h);
-			y -= h;
-			if (n == 1) {
+				"M%.2f %.2fc0.6 5.6 9.6 9 5.6 18.4\n"
+				"	1.6 -6 -1.3 -11.6 -5.6 -12.8\n",
+				x, y);
+		} else {
+			while (--n >= 0) {
 				fprintf(fout,
-					"M%.2f %.2fc0.6 -5.6 9.6 -9 5.6 -18.4\n"
-					"	1.6 6 -1.3 11.6 -5.6 12.8\n",
+					"M%.2f %.2fc0.9 3.7 9.1 6.4 6 12.4\n"
+					"	1 -5.4 -4.2 -8.4 -6 -8.4\n",
 					x, y);
-			} else {
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fc0.9 -3.7 9.1 -6.4 6 -12.4\n"
-						"	1 5.4 -4.2 8.4 -6 8.4\n",
-						x, y);
-					y -= 5.4;
-				}
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sfs") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v - 1;
-			if (h > 0) {
-				x += 3.5;
-				y -= 1;
-				fprintf(fout,
-					"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-					"<path class=\"fill\"\n"
-					"	d=\"",
-					x, y, -h + 1);
-				y -= h - 1;
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fl7 3.2 0 3.2 -7 -3.2z\n",
-						x, y);
-					y += 5.4;
-				}
-			} else {
-				x -= 3.5;
-				y += 1;
-				fprintf(fout,
-					"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-					"<path class=\"fill\"\n"
-					"	d=\"",
-					x, y, -h - 1);
-				y -= h + 1;
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fl7 -3.2 0 -3.2 -7 3.2z\n",
-						x, y);
-					y -= 5.4;
-				}
+				y += 5.4;
 			}
-			fprintf(fout, "\"/>\n");
-			return;
 		}
-		if (strcmp(op, "sgu") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v + GSTEM_XOFF;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
+		fprintf(fout, "\"/>\n");
+		return;
+	case O_sfd:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = ps_sym_lookup("x");
+		x = gcur.xoffs + sym->e->u.v - 3.5;
+		sym = ps_sym_lookup("y");
+		y = gcur.yoffs - sym->e->u.v;
+		fprintf(fout,
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		if (n == 1) {
 			fprintf(fout,
-				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-				"<path class=\"fill\"\n"
-				"	d=\"",
-				x, y, -h);
-			y -= h;
-			if (n == 1) {
+				"M%.2f %.2fc0.6 -5.6 9.6 -9 5.6 -18.4\n"
+				"	1.6 6 -1.3 11.6 -5.6 12.8\n",
+				x, y);
+		} else {
+			while (--n >= 0) {
 				fprintf(fout,
-					"M%.2f %.2fc0.6 3.4 5.6 3.8 3 10\n"
-					"	1.2 -4.4 -1.4 -7 -3 -7\n",
-					x, y);
-			} else {
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fc1 3.2 5.6 2.8 3.2 8\n"
-						"	1.4 -4.8 -2.4 -5.4 -3.2 -5.2\n",
+					"M%.2f %.2fc0.9 -3.7 9.1 -6.4 6 -12.4\n"
+					"	1 5.4 -4.2 8.4 -6 8.4\n",
 					x, y);
-					y += 3.5;
-				}
+				y -= 5.4;
 			}
-			fprintf(fout, "\"/>\n");
-			return;
 		}
-		if (strcmp(op, "sgd") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v - GSTEM_XOFF;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
+		fprintf(fout, "\"/>\n");
+		return;
+	case O_sfs:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = ps_sym_lookup("x");
+		x = gcur.xoffs + sym->e->u.v;
+		sym = ps_sym_lookup("y");
+		y = gcur.yoffs - sym->e->u.v - 1;
+		if (h > 0) {
+			x += 3.5;
+			y -= 1;
 			fprintf(fout,
 				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
 				"<path class=\"fill\"\n"
 				"	d=\"",
-				x, y, -h);
-			y -= h;
-			if (n == 1) {
+				x, y, -h + 1);
+			y -= h - 1;
+			while (--n >= 0) {
 				fprintf(fout,
-					"M%.2f %.2fc0.6 -3.4 5.6 -3.8 3 -10\n"
-					"	1.2 4.4 -1.4 7 -3 7\n",
+					"M%.2f %.2fl7 3.2 0 3.2 -7 -3.2z\n",
 					x, y);
-			} else {
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fc1 -3.2 5.6 -2.8 3.2 -8\n"
-						"	1.4 4.8 -2.4 5.4 -3.2 5.2\n",
-						x, y);
-					y -= 3.5;
-				}
+				y += 5.4;
 			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sgs") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v + GSTEM_XOFF;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
+		} else {
+			x -= 3.5;
+			y += 1;
 			fprintf(fout,
 				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
 				"<path class=\"fill\"\n"
 				"	d=\"",
-				x, y, -h);
-			y -= h;
+				x, y, -h - 1);
+			y -= h + 1;
 			while (--n >= 0) {
 				fprintf(fout,
-					"M%.2f %.2fl3 1.5 0 2 -3 -1.5z\n",
+					"M%.2f %.2fl7 -3.2 0 -3.2 -7 3.2z\n",
 					x, y);
-				y += 3;
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sfz") == 0) {
-			xysym(op, D_sfz);
-			s = pop_free_str();
-			if (s)
-				free(s);
-			return;
-		}
-		if (strcmp(op, "sgno") == 0) {
-			xysym(op, D_sgno);
-			return;
-		}
-		if (strcmp(op, "show") == 0) {
-			show('s');
-			return;
-		}
-		if (strcmp(op, "showb") == 0) {
-			show('b');
-			return;
-		}
-		if (strcmp(op, "showc") == 0) {
-			show('c');
-			return;
-		}
-		if (strcmp(op, "showr") == 0) {
-			show('r');
-			return;
-		}
-		if (strcmp(op, "showerror") == 0) {
-			xysym(op, D_showerror);
-			return;
-		}
-		if (strcmp(op, "sld") == 0) {
-			xysym(op, D_sld);
-			return;
-		}
-		if (strcmp(op, "snap") == 0) {
-			xysym(op, D_snap);
-			return;
-		}
-		if (strcmp(op, "sphr") == 0) {
-			xysym(op, D_sphr);
-			return;
-		}
-		if (strcmp(op, "spclef") == 0) {
-			xysym(op + 1, D_pclef);		// same as 'pclef'
-			return;
-		}
-		if (strcmp(op, "setrgbcolor") == 0) {
-			int rgb;
-
-			rgb = pop_free_val() * 255;
-			rgb += (int) (pop_free_val() * 255) << 8;
-			rgb += (int) (pop_free_val() * 255) << 16;
-			gcur.rgb = rgb;
-			return;
-		}
-		if (strcmp(op, "stc") == 0) {
-			xysym(op, D_stc);
-			return;
-		}
-		if (strcmp(op, "stroke") == 0) {
-			if (!path) {
-				fprintf(stderr, "svg: 'stroke' with no path\n");
-//				ps_error = 1;
-				return;
+				y -= 5.4;
 			}
-			path_end();
-			fprintf(fout, "\t\" class=\"stroke\"%s/>\n",
-					gcur.dash);
-			return;
 		}
-		if (strcmp(op, "su") == 0
-		 || strcmp(op, "sd") == 0) {
-			stem(op);
-			return;
-		}
-		if (strcmp(op, "stsig") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg: No string\n");
-				ps_error = 1;
-				return;
+		fprintf(fout, "\"/>\n");
+		return;
+	case O_sgu:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = ps_sym_lookup("x");
+		x = gcur.xoffs + sym->e->u.v + GSTEM_XOFF;
+		sym = ps_sym_lookup("y");
+		y = gcur.yoffs - sym->e->u.v;
+		fprintf(fout,
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		if (n == 1) {
+			fprintf(fout,
+				"M%.2f %.2fc0.6 3.4 5.6 3.8 3 10\n"
+				"	1.2 -4.4 -1.4 -7 -3 -7\n",
+				x, y);
+		} else {
+			while (--n >= 0) {
+				fprintf(fout,
+					"M%.2f %.2fc1 3.2 5.6 2.8 3.2 8\n"
+					"	1.4 -4.8 -2.4 -5.4 -3.2 -5.2\n",
+				x, y);
+				y += 3.5;
 			}
-			fprintf(fout, "<g style=\"font:bold 18px serif\"\n"
-				"	transform=\"translate(%.2f,%.2f) scale(1.2,1)\">\n"
-				"	<text y=\"-7\" text-anchor=\"middle\">%s</text>\n"
-				"</g>\n",
-				x, y, s + 1);
-			free(s);
-			return;
 		}
-		if (strcmp(op, "sub") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg: Bad value for sub\n");
-				ps_error = 1;
-				return;
+		fprintf(fout, "\"/>\n");
+		return;
+	case O_sgd:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = ps_sym_lookup("x");
+		x = gcur.xoffs + sym->e->u.v - GSTEM_XOFF;
+		sym = ps_sym_lookup("y");
+		y = gcur.yoffs - sym->e->u.v;
+		fprintf(fout,
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		if (n == 1) {
+			fprintf(fout,
+				"M%.2f %.2fc0.6 -3.4 5.6 -3.8 3 -10\n"
+				"	1.2 4.4 -1.4 7 -3 7\n",
+				x, y);
+		} else {
+			while (--n >= 0) {
+				fprintf(fout,
+					"M%.2f %.2fc1 -3.2 5.6 -2.8 3.2 -8\n"
+					"	1.4 4.8 -2.4 5.4 -3.2 5.2\n",
+					x, y);
+				y -= 3.5;
 			}
-			stack->u.v -= x;
-			return;
 		}
-		if (strcmp(op, "sbclef") == 0) {
-			xysym(op, D_sbclef);
-			return;
-		}
-		if (strcmp(op, "scclef") == 0) {
-			xysym(op, D_scclef);
-			return;
+		fprintf(fout, "\"/>\n");
+		return;
+	case O_sgs:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = ps_sym_lookup("x");
+		x = gcur.xoffs + sym->e->u.v + GSTEM_XOFF;
+		sym = ps_sym_lookup("y");
+		y = gcur.yoffs - sym->e->u.v;
+		fprintf(fout,
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		while (--n >= 0) {
+			fprintf(fout,
+				"M%.2f %.2fl3 1.5 0 2 -3 -1.5z\n",
+				x, y);
+			y += 3;
 		}
-		if (strcmp(op, "sh0") == 0) {
-			xysym(op, D_sh0);
+		fprintf(fout, "\"/>\n");
+		return;
+	case O_sfz:
+		xysym(op, D_sfz);
+		s = pop_free_str();
+		if (s)
+			str_free(s);
+		return;
+	case O_sgno:
+		xysym(op, D_sgno);
+		return;
+	case O_show:
+		show('s');
+		return;
+	case O_showb:
+		show('b');
+		return;
+	case O_showc:
+		show('c');
+		return;
+	case O_showr:
+		show('r');
+		return;
+	case O_showerror:
+		xysym(op, D_showerror);
+		return;
+	case O_sld:
+		xysym(op, D_sld);
+		return;
+	case O_snap:
+		xysym(op, D_snap);
+		return;
+	case O_sphr:
+		xysym(op, D_sphr);
+		return;
+	case O_spclef:
+		xysym(op + 1, D_pclef);		// same as 'pclef'
+		return;
+	case O_setrgbcolor: {
+		int rgb;
+
+		rgb = pop_free_val() * 255;
+		rgb += (int) (pop_free_val() * 255) << 8;
+		rgb += (int) (pop_free_val() * 255) << 16;
+		gcur.rgb = rgb;
+		return;
+	    }
+	case O_stc:
+		xysym(op, D_stc);
+		return;
+	case O_stroke:
+		if (!path_len) {
+			fprintf(stderr, "svg: 'stroke' with no path\n");
+//				ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "sh1") == 0) {
-			xysym(op, D_sh1);
+		path_end();
+		fprintf(fout, "\t\" class=\"stroke\"%s/>\n",
+				gcur.dash);
+		return;
+	case O_su:
+	case O_sd:
+		stem(op);
+		return;
+	case O_stsig:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "sh4") == 0) {
-			n = pop_free_val();
-			switch (n) {
-			case 1:
-				xysym("sh1", D_sh1);
-				break;
-			case 2:
-				xysym("sh0", D_sh0);
-				break;
-			case 3:
-				xysym("sh513", D_sh513);
-				break;
-			default:
-				xysym("dsh0", D_dsh0);
-				break;
-			}
+		fprintf(fout, "<g style=\"font:bold 18px serif\"\n"
+			"	transform=\"translate(%.2f,%.2f) scale(1.2,1)\">\n"
+			"	<text y=\"-7\" text-anchor=\"middle\">%s</text>\n"
+			"</g>\n",
+			x, y, s + 1);
+		str_free(s);
+		return;
+	case O_sub:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg: Bad value for sub\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "sh513") == 0) {
-			xysym(op, D_sh513);
-			return;
+		stack->u.v -= x;
+		return;
+	case O_sbclef:
+		xysym(op, D_sbclef);
+		return;
+	case O_scclef:
+		xysym(op, D_scclef);
+		return;
+	case O_sh0:
+		xysym(op, D_sh0);
+		return;
+	case O_sh1:
+		xysym(op, D_sh1);
+		return;
+	case O_sh4:
+		n = pop_free_val();
+		switch (n) {
+		case 1:
+			xysym("sh1", D_sh1);
+			break;
+		case 2:
+			xysym("sh0", D_sh0);
+			break;
+		case 3:
+			xysym("sh513", D_sh513);
+			break;
+		default:
+			xysym("dsh0", D_dsh0);
+			break;
 		}
-		if (strcmp(op, "srep") == 0) {
-			xysym(op, D_srep);
+		return;
+	case O_sh513:
+		xysym(op, D_sh513);
+		return;
+	case O_srep:
+		xysym(op, D_srep);
+		return;
+	case O_stclef:
+		xysym(op, D_stclef);
+		return;
+	case O_stringwidth:
+		s = pop_free_str();
+		if (!s || *s != '(') {
+			fprintf(stderr, "svg stringwidth: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "stclef") == 0) {
-			xysym(op, D_stclef);
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "stringwidth") == 0) {
-			s = pop_free_str();
-			if (!s || *s != '(') {
-				fprintf(stderr, "svg stringwidth: No string\n");
-				ps_error = 1;
-				return;
-			}
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = strw(s + 1);
-			push(e);
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = gcur.font_s;
-			push(e);
+		e->type = VAL;
+		e->u.v = strw(s + 1);
+		push(e);
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "svg") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = 1;
-			push(e);
+		e->type = VAL;
+		e->u.v = gcur.font_s;
+		push(e);
+		return;
+	case O_svg:
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		break;
-	case 'T':
-		if (strcmp(op, "T") == 0) {
+		e->type = VAL;
+		e->u.v = 1;
+		push(e);
+		return;
+	case O_T:
 translate:
 //fixme:test
 //			setg(1);
-			y = pop_free_val();
-			x = pop_free_val();
-			gcur.xoffs += x;
-			gcur.yoffs -= y;
-			gcur.cx -= x;
-			gcur.cy -= y;
-			return;
+		y = pop_free_val();
+		x = pop_free_val();
+		gcur.xoffs += x;
+		gcur.yoffs -= y;
+		gcur.cx -= x;
+		gcur.cy -= y;
+		return;
+	case O_tclef:
+		xysym(op, D_tclef);
+		return;
+	case O_thbar:
+		bar(DOP_thbar);
+		return;
+	case O_thumb:
+		xysym(op, D_thumb);
+		return;
+	case O_translate:
+		goto translate;
+	case O_trem:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val() - 4.5;
+		n = pop_free_val();
+		fprintf(fout, "<path class=\"fill\" d=\"m%.2f %.2f\n\t",
+			x, y);
+		for (;;) {
+			fputs("l9 -3v3l-9 3z", fout);
+			if (--n <= 0)
+				break;
+			fputs("m0 5.4", fout);
 		}
-		break;
-	case 't':
-		if (strcmp(op, "tclef") == 0) {
-			xysym(op, D_tclef);
+		fputs("\"/>", fout);
+		return;
+	case O_trl:
+		xysym(op, D_trl);
+		return;
+	case O_true:
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "thbar") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val() + 1.5;
-			h = pop_free_val();
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-width=\"3\"\n"
-				"	d=\"M%.2f %.2fv%.2f\"/>\n",
-				x, y, -h);
+		e->type = VAL;
+		e->u.v = 1;
+		push(e);
+		return;
+	case O_tsig: {
+		char *d;
+
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 0.5;
+		x = gcur.xoffs + pop_free_val();
+		d = pop_free_str();
+		s = pop_free_str();
+		if (!d || !s) {
+			fprintf(stderr, "svg: No string\n");
+			if (d)
+				str_free(d);
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "thumb") == 0) {
-			xysym(op, D_thumb);
-			return;
+		fprintf(fout, "<g style=\"font:bold 16px serif\"\n"
+			"	transform=\"translate(%.2f,%.2f) scale(1.2,1)\">\n"
+			"	<text text-anchor=\"middle\">%s</text>\n"
+			"	<text y=\"-12\" text-anchor=\"middle\">%s</text>\n"
+			"</g>\n",
+			x, y, d + 1, s + 1);
+		str_free(d);
+		str_free(s);
+		return;
+	    }
+	case O_tubr:
+	case O_tubrl: {
+		float dx, dy;
+		int h;
+
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		dy = pop_free_val();
+		dx = pop_free_val();
+		if (op[4] == 'l') {
+			h = 3;
+			y -= 3;
+		} else {
+			h = -3;
+			y += 3;
 		}
-		if (strcmp(op, "translate") == 0)
-			goto translate;
-		if (strcmp(op, "trem") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val() - 4.5;
-			n = pop_free_val();
-			fprintf(fout, "<path class=\"fill\" d=\"m%.2f %.2f\n\t",
-				x, y);
-			for (;;) {
-				fputs("l9 -3v3l-9 3z", fout);
-				if (--n <= 0)
-					break;
-				fputs("m0 5.4", fout);
-			}
-			fputs("\"/>", fout);
+		fprintf(fout,
+			"<path class=\"stroke\"\n"
+			"	d=\"M%.2f %.2fv%dl%.2f %.2fv%d\"/>\n",
+			x, y, h, dx, -dy, -h);
+		return;
+	    }
+	case O_turn:
+		xysym(op, D_turn);
+		return;
+	case O_turnx:
+		xysym(op, D_turnx);
+		return;
+	case O_upb:
+		xysym(op, D_upb);
+		return;
+	case O_umrd:
+		xysym(op, D_umrd);
+		return;
+	case O_wedge:
+		xysym(op, D_wedge);
+		return;
+	case O_wln:
+		setg(1);
+		y = pop_free_val();
+		x = pop_free_val();
+		w = pop_free_val();
+		fprintf(fout, "<path class=\"stroke\" stroke-width=\"0.8\"\n"
+			"	d=\"M%.2f %.2fh%.2f\"/>\n",
+			gcur.xoffs + x, gcur.yoffs - y, w);
+		return;
+	case O_where:
+		s = pop_free_str();		/* symbol */
+		if (!s || *s != '/') {
+			fprintf(stderr, "svg where: No / bad symbol\n");
+			if (s)
+				str_free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "trl") == 0) {
-			xysym(op, D_trl);
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "true") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
+		e->type = VAL;
+		sym = ps_sym_lookup(&s[1]);
+		if (!sym) {
+			e->u.v = 0;
+		} else {
 			e->u.v = 1;
-			push(e);
-			return;
-		}
-		if (strcmp(op, "tsig") == 0) {
-			char *d;
-
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 0.5;
-			x = gcur.xoffs + pop_free_val();
-			d = pop_free_str();
-			s = pop_free_str();
-			if (!d || !s) {
-				fprintf(stderr, "svg: No string\n");
-				if (d)
-					free(d);
-				if (s)
-					free(s);
-				ps_error = 1;
+			e2 = elt_new();		/* dictionnary */
+			if (!e2)
 				return;
-			}
-			fprintf(fout, "<g style=\"font:bold 16px serif\"\n"
-				"	transform=\"translate(%.2f,%.2f) scale(1.2,1)\">\n"
-				"	<text text-anchor=\"middle\">%s</text>\n"
-				"	<text y=\"-12\" text-anchor=\"middle\">%s</text>\n"
-				"</g>\n",
-				x, y, d + 1, s + 1);
-			free(d);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "tubr") == 0
-		 || strcmp(op, "tubrl") == 0) {
-			float dx, dy;
-			int h;
-
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			dy = pop_free_val();
-			dx = pop_free_val();
-			if (op[4] == 'l') {
-				h = 3;
-				y -= 3;
-			} else {
-				h = -3;
-				y += 3;
-			}
-			fprintf(fout,
-				"<path class=\"stroke\"\n"
-				"	d=\"M%.2f %.2fv%dl%.2f %.2fv%d\"/>\n",
-				x, y, h, dx, -dy, -h);
-			return;
-		}
-		if (strcmp(op, "turn") == 0) {
-			xysym(op, D_turn);
-			return;
-		}
-		if (strcmp(op, "turnx") == 0) {
-			xysym(op, D_turnx);
-			return;
-		}
-		break;
-	case 'u':
-		if (strcmp(op, "upb") == 0) {
-			xysym(op, D_upb);
-			return;
-		}
-		if (strcmp(op, "umrd") == 0) {
-			xysym(op, D_umrd);
-			return;
-		}
-		break;
-	case 'w':
-		if (strcmp(op, "wedge") == 0) {
-			xysym(op, D_wedge);
-			return;
-		}
-		if (strcmp(op, "wln") == 0) {
-			setg(1);
-			y = pop_free_val();
-			x = pop_free_val();
-			w = pop_free_val();
-			fprintf(fout, "<path class=\"stroke\" stroke-width=\"0.8\"\n"
-				"	d=\"M%.2f %.2fh%.2f\"/>\n",
-				gcur.xoffs + x, gcur.yoffs - y, w);
-			return;
+			e2->type = VAL;
+			e2->u.v = 0;
+			push(e2);
 		}
-		if (strcmp(op, "where") == 0) {
-			s = pop_free_str();		/* symbol */
-			if (!s || *s != '/') {
-				fprintf(stderr, "svg where: No / bad symbol\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			sym = ps_sym_lookup(&s[1]);
-			if (!sym) {
-				e->u.v = 0;
-			} else {
-				e->u.v = 1;
-				e2 = elt_new();		/* dictionnary */
-				if (!e2)
-					return;
-				e2->type = VAL;
-				e2->u.v = 0;
-				push(e2);
+		str_free(s);
+		push(e);
+		return;
+	case O_xydef:
+		y = pop_free_val();
+		x = pop_free_val();
+		setxory("x", x);
+		setxory("y", y);
+		return;
+	case O_xymove:
+		gcur.cy = pop_free_val();
+		gcur.cx = pop_free_val();
+		setxory("x", gcur.cx);
+		setxory("y", gcur.cy);
+		return;
+	default:
+		if (sscanf(op, "F%d", &n) == 1) {
+			h = pop_free_val();
+			if (gcur.font_s != h
+			 || strcmp(fontnames[n], gcur.font_n) != 0) {
+				free(gcur.font_n_old);
+				gcur.font_n_old = gcur.font_n;
+				gcur.font_n = strdup(fontnames[n]);
+				gcur.font_s = h;
 			}
-			free(s);
-			push(e);
-			return;
-		}
-		break;
-	case 'x':
-		if (strcmp(op, "xydef") == 0) {
-			y = pop_free_val();
-			x = pop_free_val();
-			setxory("x", x);
-			setxory("y", y);
-			return;
-		}
-		if (strcmp(op, "xymove") == 0) {
-			gcur.cy = pop_free_val();
-			gcur.cx = pop_free_val();
-			setxory("x", gcur.cx);
-			setxory("y", gcur.cy);
 			return;
 		}
 		break;
@@ -4337,7 +4850,7 @@ translate:
 	ps_error = 1;
 }
 
-void svg_write(char *buf, int len)
+static void svg_write1(char *buf, int len)
 {
 	int l;
 	struct elt_s *e, *e2;
@@ -4363,6 +4876,35 @@ void svg_write(char *buf, int len)
 		case '\t':
 		case '\n':
 			continue;
+		case REC:
+			if (*p == 'v') {		/* value */
+				e = elt_new();
+				if (!e)
+					return;
+				e->type = VAL;
+				e->u.v = rec_get(p + 1);
+				p += 7;
+				len -= 7;
+				push(e);
+				break;
+			}
+			c = p[1] - '0';			/* operator */
+			p += 2;
+			len -= 2;
+			if (!in_cnt) {
+				dop_exec(c);
+				if (ps_error)
+					return;
+				continue;
+			}
+			e = elt_new();
+			if (!e)
+				return;
+			e->type = STR;
+			e->nm = dop_op[c];
+			e->u.s = ps_sym[e->nm].n;
+			push(e);
+			break;
 		case '{':
 		case '[':		/* treat '[' as '{' */
 			e = elt_new();
@@ -4370,7 +4912,7 @@ void svg_write(char *buf, int len)
 				return;
 			in_cnt++;
 			e->type = STR;
-			e->u.s = strdup(c == '{' ? "{" : "[");
+			e->u.s = c == '{' ? &str_brace[1] : &str_bracket[1];
 			push(e);
 			break;
 		case '}':
@@ -4483,7 +5025,7 @@ void svg_write(char *buf, int len)
 			if (!e)
 				return;
 			e->type = STR;
-			r = malloc(l);
+			r = (unsigned char *) str_new(l);
 			e->u.s = (char *) r;
 			for (;;) {
 				c = *p++;
@@ -4517,6 +5059,7 @@ void svg_write(char *buf, int len)
 				case ']':
 				case '%':
 				case '/':
+				case REC:
 					break;
 				default:
 					continue;
@@ -4557,7 +5100,7 @@ void svg_write(char *buf, int len)
 					if (*q != '/') {	/* operator */
 						c = *p;
 						*p = '\0';
-						ps_exec((char *) q);
+						ps_exec(sym_get((char *) q));
 						if (ps_error)
 							return;
 						*p = c;
@@ -4576,15 +5119,19 @@ void svg_write(char *buf, int len)
 					elt_free(e);
 					break;
 				}
-				l = p - q;
-				r = malloc(l + 1);
-				memcpy(r, q, l);
-				r[l] = '\0';
 				e = elt_new();
 				if (!e)
 					return;
 				e->type = STR;
-				e->u.s = (char *) r;
+				c = *p;
+				*p = '\0';
+				if (*q != '/') {	/* executable name */
+					e->nm = sym_get((char *) q);
+					e->u.s = ps_sym[e->nm].n;
+				} else {
+					e->u.s = str_dup((char *) q);
+				}
+				*p = c;
 			}
 			push(e);
 			break;
@@ -4592,6 +5139,13 @@ void svg_write(char *buf, int len)
 	}
 }
 
+void svg_write(char *buf, int len)
+{
+	prof_begin(PROF_SVG);
+	svg_write1(buf, len);
+	prof_end(PROF_SVG);
+}
+
 int svg_output(FILE *out, const char *fmt, ...)
 {
 	va_list args;
@@ -4622,4 +5176,5 @@ void svg_close(void)
 			e = e2;
 		} while (e);
 	}
+	str_reset();
 }